@@ -0,0 +1,128 @@
+/*
+ * QIClib (Quantum information and computation library)
+ *
+ * Copyright (c) 2015 - 2019  Titas Chanda (titas.chanda@gmail.com)
+ *
+ * This file is part of QIClib.
+ *
+ * QIClib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QIClib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QIClib.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Runs the same noisy circuit on single- and double-precision states and
+// checks that partial traces, outcome probabilities and trajectory averages
+// of the float run agree with the double run. The long sums behind them
+// are carried in double precision, so the float results also match the
+// double-precision evaluation of the float state to within one final
+// rounding, which a float accumulation over 2^18 terms would not.
+
+#include <QIClib>
+
+static_assert(std::is_same<qic::acc_type<arma::cx_float>::type,
+                           arma::cx_double>::value,
+              "cx_float sums must be accumulated in cx_double");
+static_assert(std::is_same<qic::acc_type<float>::type, double>::value,
+              "float sums must be accumulated in double");
+
+template <typename T1, typename T2>
+double max_diff(const arma::Mat<T1>& A, const arma::Mat<T2>& B) {
+  const arma::mat d = arma::abs(arma::conv_to<arma::cx_mat>::from(A) -
+                                arma::conv_to<arma::cx_mat>::from(B));
+  return d.max();
+}
+
+int main() {
+  using namespace arma;
+  using namespace qic;
+
+  const uword n = 18;
+  const uword D = uword(1) << n;
+
+  rdevs.set_seed(1234);
+
+  // circuit and state in double precision, then rounded to float
+  const cx_vec psi0 = randPsi(D);
+  const cx_fvec fpsi0 = conv_to<cx_fvec>::from(psi0);
+
+  std::vector<cx_mat> U;
+  for (uword i = 0; i < n; ++i)
+    U.push_back(randUnitary(2));
+  const cx_mat CZ = diagmat(cx_vec{1.0, 1.0, 1.0, -1.0});
+
+  circuit<cx_double> C(n, 2);
+  circuit<cx_float> fC(n, 2);
+  for (uword i = 0; i < n; ++i) {
+    C.add(U[i], {i + 1});
+    fC.add(conv_to<cx_fmat>::from(U[i]), {i + 1});
+  }
+  for (uword i = 1; i < n; ++i) {
+    C.add(CZ, {i, i + 1});
+    fC.add(conv_to<cx_fmat>::from(CZ), {i, i + 1});
+  }
+
+  cx_vec psi = psi0;
+  cx_fvec fpsi = fpsi0;
+  C.run(psi);
+  fC.run(fpsi);
+
+  const cx_vec fpsi_d = conv_to<cx_vec>::from(fpsi);
+  const uvec tr = regspace<uvec>(3, n);
+
+  bool ok = true;
+  auto check = [&ok](const char* what, double err, double tol) {
+    std::cout << what << ": " << err << std::endl;
+    if (!(err <= tol)) {
+      std::cerr << "  exceeds " << tol << std::endl;
+      ok = false;
+    }
+  };
+
+  // float vs double run: limited by the float gate application
+  check("TrX", max_diff(TrX(fpsi, tr), TrX(psi, tr)), 1e-4);
+
+  // float vs the double-precision evaluation of the same float state:
+  // only the final rounding to float remains
+  check("TrX rounding", max_diff(TrX(fpsi, tr), TrX(fpsi_d, tr)), 1e-6);
+
+  const cx_fmat fI = eye<cx_fmat>(4, 4);
+  const cx_mat I = eye<cx_mat>(4, 4);
+  const auto fp = measure_prob(fpsi, fI, {1, 2});
+  check("measure_prob", max_diff(mat(conv_to<vec>::from(fp)),
+                                 mat(measure_prob(psi, I, {1, 2}))),
+        1e-4);
+  check("measure_prob rounding",
+        max_diff(mat(conv_to<vec>::from(fp)),
+                 mat(measure_prob(fpsi_d, I, {1, 2}))),
+        1e-6);
+
+  // trajectories with the same seed draw the same jumps
+  const cx_mat K0 = diagmat(cx_vec{1.0, std::sqrt(0.9)});
+  const cx_mat K1 = diagmat(cx_vec{0.0, std::sqrt(0.1)});
+
+  trajectory<cx_double> T(n, 2);
+  trajectory<cx_float> fT(n, 2);
+  T.add(U[0], {1}).add_channel(std::vector<cx_mat>{K0, K1}, {1});
+  fT.add(conv_to<cx_fmat>::from(U[0]), {1})
+    .add_channel(std::vector<cx_fmat>{conv_to<cx_fmat>::from(K0),
+                                      conv_to<cx_fmat>::from(K1)},
+                 {1});
+
+  rdevs.set_seed(99);
+  const cx_mat R = T.rdm(psi, 8, {1, 2});
+  rdevs.set_seed(99);
+  const cx_fmat fR = fT.rdm(fpsi, 8, {1, 2});
+  check("trajectory::rdm", max_diff(fR, R), 1e-4);
+
+  std::cout << (ok ? "float mode OK" : "float mode FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
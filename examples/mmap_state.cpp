@@ -0,0 +1,110 @@
+/*
+ * QIClib (Quantum information and computation library)
+ *
+ * Copyright (c) 2015 - 2019  Titas Chanda (titas.chanda@gmail.com)
+ *
+ * This file is part of QIClib.
+ *
+ * QIClib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QIClib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QIClib.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Runs a circuit on a memory-mapped state with tiny chunks (four
+// amplitudes, i.e. the last two qubits) and on an in-memory cx_vec, and
+// checks that amplitudes, norm and measurement probabilities agree. Gates
+// on the last two qubits take the per-chunk path, all others the gather
+// path. The state is then moved, and gates and measurements on the
+// leading qubit are checked on the moved-to object.
+
+#define QICLIB_USE_MMAP
+#include <QIClib>
+
+#ifdef QICLIB_MMAP
+
+#include <cstdio>
+
+int main() {
+  using namespace arma;
+  using namespace qic;
+
+  const uword n = 10;
+  const char* path = "qiclib_mmap_state.bin";
+
+  rdevs.set_seed(2019);
+
+  circuit<cx_double> C(n, 2);
+  C.set_fuse_limit(1);  // keep the gates apart, to exercise both paths
+  const cx_mat CZ = diagmat(cx_vec{1.0, 1.0, 1.0, -1.0});
+  for (uword i = 1; i <= n; ++i)
+    C.add(randUnitary(2), {i});
+  for (uword i = 1; i < n; ++i)
+    C.add(CZ, {i, i + 1});
+  C.add_ctrl(randUnitary(2), {n}, {1});
+  C.add_ctrl(randUnitary(4), {1}, {n - 1, n});
+
+  cx_vec psi(uword(1) << n, fill::zeros);
+  psi.at(0) = 1.0;
+  C.run(psi);
+
+  bool ok = true;
+  auto check = [&ok](const char* what, double err) {
+    std::cout << what << ": " << err << std::endl;
+    if (!(err <= 1e-10)) {
+      std::cerr << "  exceeds 1e-10" << std::endl;
+      ok = false;
+    }
+  };
+
+  auto amp_diff = [](const cx_vec& v, const cx_double* x) {
+    double d(0);
+    for (uword i = 0; i < v.n_elem; ++i)
+      d = std::max(d, std::abs(v.at(i) - x[i]));
+    return d;
+  };
+
+  {
+    mmap_state<cx_double> s(path, n, 2);
+    s.set_chunk_bytes(64);
+    s.run(C);
+
+    check("amplitudes", amp_diff(psi, s.memptr()));
+    check("norm", std::abs(s.norm() - norm(psi)));
+
+    // moved-to state: gate on the leading qubit, then measure it with a
+    // trailing one
+    mmap_state<cx_double> t(std::move(s));
+    const cx_mat H = randUnitary(2);
+    t.apply(H, {1});
+    apply_inplace(psi, H, {1});
+    check("moved amplitudes", amp_diff(psi, t.memptr()));
+
+    const vec p = measure_prob(psi, eye<cx_mat>(4, 4), {1, n});
+    const auto r = t.measure_comp({1, n});
+    check("measure_comp", max(abs(std::get<1>(r) - p)));
+    check("collapsed norm", std::abs(t.norm() - 1.0));
+  }
+
+  std::remove(path);
+
+  std::cout << (ok ? "mmap_state OK" : "mmap_state FAILED") << std::endl;
+  return ok ? 0 : 1;
+}
+
+#else
+
+int main() {
+  std::cout << "mmap_state needs POSIX mmap" << std::endl;
+  return 0;
+}
+
+#endif
@@ -42,8 +42,6 @@ bool shor(arma::uword N, arma::uvec &fact) {
   // Check complete
 
   
-  double pi = arma::datum::pi; //  PI
-  arma::cx_double I(0.0, 1.0); // imaginary I
   bool ret = false; // return value
   std::uniform_int_distribution<arma::uword> dis(1, N - 1); // RNG for 1 to N-1
   arma::uword count(0); // trial count
@@ -74,41 +72,26 @@ bool shor(arma::uword N, arma::uvec &fact) {
     std::cout << "a = " << a << std::endl;
     std::cout << "gcd = " << gcd1 << std::endl << std::endl;
 
-    // Create registers
-    arma::vec reg1 = arma::zeros<arma::vec>(Q);
-    arma::vec reg2 = arma::zeros<arma::vec>(Q2);
-    arma::uvec modex = arma::zeros<arma::uvec>(Q);
+    // Joint register |x>|y>, x in uniform superposition and y = 1
+    const arma::uvec dims = {Q, Q2};
+    arma::cx_vec state = arma::zeros<arma::cx_vec>(Q * Q2);
+    for (arma::uword i = 0; i < Q; ++i)
+      state.at(i * Q2 + 1) = 1.0 / std::sqrt(static_cast<double>(Q));
 
-    // initialize register 2
-    for (arma::uword i = 0; i < Q; ++i) {
-      modex(i) = qic::modexp(a, i, N);
-      reg2.at(modex(i)) += 1.0;
-    }
-    reg2 = arma::normalise(reg2);
+    // |x>|y> -> |x>|y a^x mod N>
+    qic::apply_perm_inplace(state, qic::modexp_map(a, N, Q2), {1, 2}, dims);
 
-    // measure register 2 
-    auto measure1 = qic::measure_comp(reg2);
+    // measure register 2, collapsing register 1
+    auto measure1 = qic::measure_comp_inplace(state, {2}, dims);
     arma::uword result1 = std::get<0>(measure1);
 
-    // collapse register 1
-    for (arma::uword i = 0; i < Q; ++i) {
-      if (result1 == modex(i))
-        reg1.at(i)++;
-    }
-    reg1 = arma::normalise(reg1);
+    arma::cx_vec reg1(Q);
+    for (arma::uword i = 0; i < Q; ++i)
+      reg1.at(i) = state.at(i * Q2 + result1);
 
     // Do QFT
-    arma::cx_vec state2 = arma::zeros<arma::cx_vec>(Q); // for QFT output
     std::cout << "QFT begins..." << std::endl;
-    QICLIB_OPENMP_FOR
-    for (arma::uword j = 0; j < Q; ++j) {
-      for (arma::uword i = 0; i < Q; ++i) {
-        state2.at(j) += std::exp(2.0 * pi * I * static_cast<double>(i * j) /
-                                 static_cast<double>(Q)) *
-                        reg1.at(i);
-      }
-    }
-    state2 /= std::sqrt(Q);
+    arma::cx_vec state2 = qic::qft(reg1, {1}, arma::uvec{Q});
     std::cout << "QFT done." << std::endl << std::endl;
 
     arma::uword count2(0); // count for possible period finder check
@@ -171,7 +154,7 @@ bool shor(arma::uword N, arma::uvec &fact) {
 
 int main() {
   arma::uvec f;
-  shor(47 * 163, f);
+  shor(11 * 13, f);
 
   std::cout << f << std::endl;
 }
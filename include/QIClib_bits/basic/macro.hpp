@@ -36,6 +36,45 @@
 #define QICLIB_MAXQDIT_COUNT 40
 #endif
 
+// Block of amplitude tuples handled by one iteration of the apply kernels
+#ifndef QICLIB_APPLY_BLOCK
+#define QICLIB_APPLY_BLOCK 1024
+#endif
+
+// Number of partial sums of a deterministic parallel reduction, used with
+// QICLIB_DETERMINISTIC_REDUCE
+#ifndef QICLIB_REDUCE_BLOCKS
+#define QICLIB_REDUCE_BLOCKS 16
+#endif
+
+// Tile edge, in elements, of the blocked tensor transpose
+#ifndef QICLIB_TRANSPOSE_BLOCK
+#define QICLIB_TRANSPOSE_BLOCK 32
+#endif
+
+// hand-vectorized apply kernels (x86 with runtime dispatch) on or off
+#if !defined(QICLIB_NO_SIMD) && (__GNUC__ || __clang__) &&                     \
+  (defined(__x86_64__) || defined(__i386__))
+#define QICLIB_SIMD
+#endif
+
+// pdep/pext bit scatter and gather instructions for index arithmetic on
+// registers of power-of-two dimensions, when the target has BMI2
+#if !defined(QICLIB_NO_BMI2) && defined(__BMI2__) && defined(__x86_64__)
+#define QICLIB_BMI2
+#endif
+
+// memory-mapped (out-of-core) state vectors, opt-in with QICLIB_USE_MMAP
+// (POSIX only); they pull the POSIX file and mapping headers into <QIClib>
+#if defined(QICLIB_USE_MMAP) && (defined(__unix__) || defined(__APPLE__))
+#define QICLIB_MMAP
+#endif
+
+// Bytes of a memory-mapped state vector processed as one in-memory chunk
+#ifndef QICLIB_MMAP_CHUNK_BYTES
+#define QICLIB_MMAP_CHUNK_BYTES 268435456
+#endif
+
 #ifndef QICLIB_DC_USE_LIMIT
 #define QICLIB_DC_USE_LIMIT 20
 #endif
@@ -188,6 +188,32 @@ inline arma::sword numerator(double c, arma::uword qmax) {
 
 //******************************************************************************
 
+namespace _internal {
+
+// (x * y) % n without overflowing arma::uword; x and y must be below n.
+
+inline arma::uword mulmod(arma::uword x, arma::uword y, arma::uword n) {
+#if defined(__SIZEOF_INT128__)
+  return static_cast<arma::uword>(static_cast<unsigned __int128>(x) * y % n);
+#else
+  if (x < 4294967296ULL && y < 4294967296ULL)
+    return (x * y) % n;
+
+  arma::uword value = 0;
+  while (y > 0) {
+    if (y & 1)
+      value = (value >= n - x) ? value - (n - x) : value + x;
+    x = (x >= n - x) ? x - (n - x) : x + x;
+    y >>= 1;
+  }
+  return value;
+#endif
+}
+
+}  // namespace _internal
+
+//******************************************************************************
+
 inline arma::uword modexp(arma::uword x, arma::uword a, arma::uword n) {
 #ifndef QICLIB_NO_DEBUG
   if (n == 0 || (a == 0 && n == 0))
@@ -199,9 +225,9 @@ inline arma::uword modexp(arma::uword x, arma::uword a, arma::uword n) {
   tmp = x % n;
   while (a > 0) {
     if (a & 1) {
-      value = (value * tmp) % n;
+      value = _internal::mulmod(value, tmp, n);
     }
-    tmp = tmp * tmp % n;
+    tmp = _internal::mulmod(tmp, tmp, n);
     a = a >> 1;
   }
   return value;
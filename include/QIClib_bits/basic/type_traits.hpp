@@ -308,6 +308,18 @@ struct is_same_pT_var<T1, T2, T3...> {
 
 //*****************************************************************************
 
+// Type in which long sums of T1 are carried: single-precision sums are
+// accumulated in double precision and rounded once at the end
+template <typename T1> struct acc_type { using type = T1; };
+
+template <> struct acc_type<float> { using type = double; };
+
+template <> struct acc_type<std::complex<float> > {
+  using type = std::complex<double>;
+};
+
+//*****************************************************************************
+
 }  // namespace qic
 
 #endif
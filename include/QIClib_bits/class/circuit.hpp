@@ -0,0 +1,297 @@
+/*
+ * QIClib (Quantum information and computation library)
+ *
+ * Copyright (c) 2015 - 2019  Titas Chanda (titas.chanda@gmail.com)
+ *
+ * This file is part of QIClib.
+ *
+ * QIClib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QIClib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QIClib.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _QICLIB_CIRCUIT_HPP_
+#define _QICLIB_CIRCUIT_HPP_
+
+#include "../basic/macro.hpp"
+#include "../basic/type_traits.hpp"
+#include "../function/make_ctrl.hpp"
+#include "../internal/apply_kernel.hpp"
+#include "../internal/as_arma.hpp"
+#include "exception.hpp"
+#include <armadillo>
+#include <vector>
+
+namespace qic {
+
+//******************************************************************************
+
+// Records (controlled) gates on a register and executes them in place on
+// state vectors or density matrices. Before execution, consecutive gates
+// whose combined support has at most fuse_limit() subsystems are fused into
+// a single local unitary, so that each fused block costs one pass over the
+// state.
+
+template <typename T1, typename Enable = typename std::enable_if<
+                         std::is_floating_point<trait::GPT<T1> >::value,
+                         void>::type>
+class circuit {
+ public:
+  struct gate {
+    arma::Mat<T1> A;
+    arma::uvec ctrl;
+    arma::uvec subsys;
+  };
+
+  //****************************************************************************
+
+  explicit circuit(arma::uvec dim) : _dim(std::move(dim)) {
+#ifndef QICLIB_NO_DEBUG
+    if (_dim.n_elem == 0 || arma::any(_dim == 0))
+      throw Exception("qic::circuit", Exception::type::INVALID_DIMS);
+#endif
+  }
+
+  circuit(arma::uword n, arma::uword dim) : _dim(n) {
+#ifndef QICLIB_NO_DEBUG
+    if (n == 0 || dim == 0)
+      throw Exception("qic::circuit", Exception::type::INVALID_DIMS);
+#endif
+    _dim.fill(dim);
+  }
+
+  //****************************************************************************
+
+  template <typename T2, typename = typename std::enable_if<
+                           is_all_same<T1, typename promote_var<
+                                             T1, trait::eT<T2> >::type>::value,
+                           void>::type>
+  circuit& add_ctrl(const T2& A1, arma::uvec ctrl, arma::uvec subsys) {
+    const auto& A = _internal::as_Mat(A1);
+
+#ifndef QICLIB_NO_DEBUG
+    const arma::uvec ctrlsubsys = arma::join_cols(subsys, ctrl);
+
+    if (A.n_elem == 0)
+      throw Exception("qic::circuit::add", Exception::type::ZERO_SIZE);
+
+    if (A.n_rows != A.n_cols)
+      throw Exception("qic::circuit::add", Exception::type::MATRIX_NOT_SQUARE);
+
+    if (subsys.n_elem == 0 || ctrlsubsys.n_elem > _dim.n_elem ||
+        arma::unique(ctrlsubsys).eval().n_elem != ctrlsubsys.n_elem ||
+        arma::any(ctrlsubsys > _dim.n_elem) || arma::any(ctrlsubsys == 0))
+      throw Exception("qic::circuit::add", Exception::type::INVALID_SUBSYS);
+
+    for (arma::uword i = 1; i < ctrl.n_elem; ++i)
+      if (_dim.at(ctrl.at(i) - 1) != _dim.at(ctrl.at(0) - 1))
+        throw Exception("qic::circuit::add", Exception::type::DIMS_NOT_EQUAL);
+
+    if (arma::prod(_dim(subsys - 1)) != A.n_rows)
+      throw Exception("qic::circuit::add",
+                      Exception::type::DIMS_MISMATCH_MATRIX);
+#endif
+
+    _gates.push_back(
+      {_internal::as_type<arma::Mat<T1> >::from(A), std::move(ctrl),
+       std::move(subsys)});
+    _compiled = false;
+    return *this;
+  }
+
+  //****************************************************************************
+
+  template <typename T2, typename = typename std::enable_if<
+                           is_all_same<T1, typename promote_var<
+                                             T1, trait::eT<T2> >::type>::value,
+                           void>::type>
+  circuit& add(const T2& A, arma::uvec subsys) {
+    return add_ctrl(A, {}, std::move(subsys));
+  }
+
+  //****************************************************************************
+
+  void set_fuse_limit(arma::uword k) noexcept {
+    _fuse = k;
+    _compiled = false;
+  }
+
+  arma::uword fuse_limit() const noexcept { return _fuse; }
+
+  const arma::uvec& dim() const noexcept { return _dim; }
+
+  arma::uword n_gates() const noexcept { return _gates.size(); }
+
+  const std::vector<gate>& gates() const noexcept { return _gates; }
+
+  void clear() noexcept {
+    _gates.clear();
+    _fused.clear();
+    _compiled = false;
+  }
+
+  //****************************************************************************
+
+  const std::vector<gate>& fused() {
+    compile();
+    return _fused;
+  }
+
+  //****************************************************************************
+
+  void compile() {
+    if (_compiled)
+      return;
+
+    _fused.clear();
+
+    gate block;
+    arma::uvec S;
+    arma::uword count(0);
+
+    for (const auto& g : _gates) {
+      arma::uvec G = arma::sort(arma::join_cols(g.ctrl, g.subsys));
+
+      if (G.n_elem > _fuse) {
+        flush(block, count);
+        _fused.push_back(g);
+        continue;
+      }
+
+      arma::uvec L =
+        count > 0 ? arma::unique(arma::join_cols(S, G)).eval() : G;
+
+      if (count > 0 && L.n_elem > _fuse) {
+        flush(block, count);
+        L = std::move(G);
+      }
+
+      if (count == 0) {
+        block = g;
+      } else {
+        if (count == 1)
+          block = {local(block, S), {}, S};
+        if (L.n_elem != S.n_elem)
+          block.A = local(block, L);
+        block.A = local(g, L) * block.A;
+        block.subsys = L;
+      }
+      S = std::move(L);
+      ++count;
+    }
+    flush(block, count);
+
+    _compiled = true;
+  }
+
+  //****************************************************************************
+
+  void run(arma::Mat<T1>& rho) {
+#ifndef QICLIB_NO_DEBUG
+    if (rho.n_elem == 0)
+      throw Exception("qic::circuit::run", Exception::type::ZERO_SIZE);
+
+    if (rho.n_cols != 1 && rho.n_rows != rho.n_cols)
+      throw Exception("qic::circuit::run",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+    if (arma::prod(_dim) != rho.n_rows)
+      throw Exception("qic::circuit::run",
+                      Exception::type::DIMS_MISMATCH_MATRIX);
+#endif
+
+    compile();
+    for (const auto& g : _fused)
+      _internal::apply_ctrl_kernel(rho, g.A, g.ctrl, g.subsys, _dim);
+  }
+
+  //****************************************************************************
+
+  // Runs the circuit on every column of X, each an independent state vector
+  void run_batch(arma::Mat<T1>& X) {
+#ifndef QICLIB_NO_DEBUG
+    if (X.n_elem == 0)
+      throw Exception("qic::circuit::run_batch", Exception::type::ZERO_SIZE);
+
+    if (arma::prod(_dim) != X.n_rows)
+      throw Exception("qic::circuit::run_batch",
+                      Exception::type::DIMS_MISMATCH_MATRIX);
+#endif
+
+    compile();
+    for (const auto& g : _fused)
+      _internal::apply_ctrl_batch_kernel(X, g.A, g.ctrl, g.subsys, _dim);
+  }
+
+  //****************************************************************************
+
+  // Runs the circuit on every slice of rhos, each an independent state
+  // vector (n_cols == 1) or density matrix
+  void run(arma::Cube<T1>& rhos) {
+#ifndef QICLIB_NO_DEBUG
+    if (rhos.n_elem == 0)
+      throw Exception("qic::circuit::run", Exception::type::ZERO_SIZE);
+
+    if (rhos.n_cols != 1 && rhos.n_rows != rhos.n_cols)
+      throw Exception("qic::circuit::run",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+    if (arma::prod(_dim) != rhos.n_rows)
+      throw Exception("qic::circuit::run",
+                      Exception::type::DIMS_MISMATCH_MATRIX);
+#endif
+
+    compile();
+    for (const auto& g : _fused)
+      _internal::apply_ctrl_cube_kernel(rhos, g.A, g.ctrl, g.subsys, _dim);
+  }
+
+  //****************************************************************************
+
+ private:
+  arma::uvec _dim;
+  std::vector<gate> _gates{};
+  std::vector<gate> _fused{};
+  arma::uword _fuse{3};
+  bool _compiled{false};
+
+  //****************************************************************************
+
+  // g embedded in the (sorted) subsystems L, as a dense local unitary
+  arma::Mat<T1> local(const gate& g, const arma::uvec& L) const {
+    arma::uvec ctrl(g.ctrl.n_elem), subsys(g.subsys.n_elem);
+    for (arma::uword i = 0; i < L.n_elem; ++i) {
+      for (arma::uword j = 0; j < g.ctrl.n_elem; ++j)
+        if (g.ctrl.at(j) == L.at(i))
+          ctrl.at(j) = i + 1;
+      for (arma::uword j = 0; j < g.subsys.n_elem; ++j)
+        if (g.subsys.at(j) == L.at(i))
+          subsys.at(j) = i + 1;
+    }
+    return make_ctrl(g.A, std::move(ctrl), std::move(subsys), _dim(L - 1));
+  }
+
+  //****************************************************************************
+
+  void flush(gate& block, arma::uword& count) {
+    if (count > 0)
+      _fused.push_back(std::move(block));
+    block = gate();
+    count = 0;
+  }
+};
+
+//******************************************************************************
+
+}  // namespace qic
+
+#endif
@@ -0,0 +1,455 @@
+/*
+ * QIClib (Quantum information and computation library)
+ *
+ * Copyright (c) 2015 - 2019  Titas Chanda (titas.chanda@gmail.com)
+ *
+ * This file is part of QIClib.
+ *
+ * QIClib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QIClib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QIClib.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _QICLIB_MMAP_STATE_HPP_
+#define _QICLIB_MMAP_STATE_HPP_
+
+#include "../basic/macro.hpp"
+
+#ifdef QICLIB_MMAP
+
+#include "../basic/type_traits.hpp"
+#include "../internal/apply_kernel.hpp"
+#include "../internal/as_arma.hpp"
+#include "../internal/constants.hpp"
+#include "../internal/reduce.hpp"
+#include "../internal/sampling.hpp"
+#include "circuit.hpp"
+#include "exception.hpp"
+#include "random_devices.hpp"
+#include <algorithm>
+#include <armadillo>
+#include <cstring>
+#include <fcntl.h>
+#include <random>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <tuple>
+#include <unistd.h>
+
+namespace qic {
+
+//******************************************************************************
+
+// State vector of a register too large for RAM, stored in a file and mapped
+// into memory. The state is processed in chunks of at most chunk_bytes(),
+// each chunk spanning the trailing (least significant) subsystems of the
+// register. Gates acting only on those subsystems are applied chunk by
+// chunk; gates touching a leading subsystem gather the chunks that differ
+// only in the touched leading digits (a pair of chunks for one qubit) into
+// one buffer, apply the gate there and scatter the result back.
+//
+// A new file is initialised to |0...0>; with reuse = true an existing file
+// holding prod(dim) amplitudes is mapped as it is.
+//
+// Available only with QICLIB_USE_MMAP defined before including QIClib.
+
+template <typename T1, typename Enable = typename std::enable_if<
+                         std::is_floating_point<trait::GPT<T1> >::value,
+                         void>::type>
+class mmap_state {
+ public:
+  using pT = trait::GPT<T1>;
+
+  //****************************************************************************
+
+  mmap_state(const std::string& path, arma::uvec dim, bool reuse = false)
+      : _dim(std::move(dim)) {
+#ifndef QICLIB_NO_DEBUG
+    if (_dim.n_elem == 0 || _dim.n_elem > _internal::MAXQDIT ||
+        arma::any(_dim == 0))
+      throw Exception("qic::mmap_state", Exception::type::INVALID_DIMS);
+#endif
+
+    _n = arma::prod(_dim);
+    const std::size_t bytes = _n * sizeof(T1);
+
+    _fd = ::open(path.c_str(), reuse ? O_RDWR : (O_RDWR | O_CREAT | O_TRUNC),
+                 0644);
+    if (_fd < 0)
+      throw Exception("qic::mmap_state", "Cannot open " + path + "!");
+
+    if (reuse) {
+      struct stat sb;
+      if (::fstat(_fd, &sb) != 0 ||
+          static_cast<std::size_t>(sb.st_size) != bytes) {
+        ::close(_fd);
+        throw Exception("qic::mmap_state",
+                        Exception::type::DIMS_MISMATCH_MATRIX);
+      }
+    } else if (::ftruncate(_fd, static_cast<off_t>(bytes)) != 0) {
+      ::close(_fd);
+      throw Exception("qic::mmap_state", "Cannot resize " + path + "!");
+    }
+
+    void* p =
+      ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    if (p == MAP_FAILED) {
+      ::close(_fd);
+      throw Exception("qic::mmap_state", "Cannot map " + path + "!");
+    }
+    _x = static_cast<T1*>(p);
+
+    if (!reuse)
+      _x[0] = static_cast<T1>(1);
+
+    set_chunk_bytes(_internal::MMAP_CHUNK_BYTES);
+  }
+
+  mmap_state(const std::string& path, arma::uword n, arma::uword dim,
+             bool reuse = false)
+      : mmap_state(path, arma::uvec(arma::uvec(n).fill(dim)), reuse) {}
+
+  mmap_state(const mmap_state&) = delete;
+  mmap_state& operator=(const mmap_state&) = delete;
+
+  mmap_state(mmap_state&& o) noexcept
+      : _dim(std::move(o._dim)),
+        _n(o._n),
+        _fd(o._fd),
+        _x(o._x),
+        _split(o._split),
+        _chunk(o._chunk),
+        _nchunk(o._nchunk) {
+    std::copy(o._hstride, o._hstride + _internal::MAXQDIT, _hstride);
+    o._fd = -1;
+    o._x = nullptr;
+  }
+
+  ~mmap_state() { release(); }
+
+  //****************************************************************************
+
+  const arma::uvec& dim() const noexcept { return _dim; }
+
+  arma::uword n_elem() const noexcept { return _n; }
+
+  arma::uword chunk_size() const noexcept { return _chunk; }
+
+  arma::uword n_chunks() const noexcept { return _nchunk; }
+
+  T1* memptr() noexcept { return _x; }
+
+  const T1* memptr() const noexcept { return _x; }
+
+  // Flushes the mapped pages to the file
+  void sync() {
+    if (_x != nullptr && ::msync(_x, _n * sizeof(T1), MS_SYNC) != 0)
+      throw Exception("qic::mmap_state::sync", "Cannot sync the state!");
+  }
+
+  //****************************************************************************
+
+  // Chunks span the largest trailing block of subsystems that fits in
+  // bytes, and at least the last subsystem
+  void set_chunk_bytes(arma::uword bytes) noexcept {
+    _split = _dim.n_elem - 1;
+    _chunk = _dim.at(_split);
+    while (_split > 0 && _chunk * _dim.at(_split - 1) * sizeof(T1) <= bytes)
+      _chunk *= _dim.at(--_split);
+    _nchunk = _n / _chunk;
+
+    _hstride[_split > 0 ? _split - 1 : 0] = 1;
+    for (arma::uword i = _split > 0 ? _split - 1 : 0; i-- > 0;)
+      _hstride[i] = _hstride[i + 1] * _dim.at(i + 1);
+  }
+
+  //****************************************************************************
+
+  template <typename T2, typename = typename std::enable_if<
+                           is_all_same<T1, typename promote_var<
+                                             T1, trait::eT<T2> >::type>::value,
+                           void>::type>
+  mmap_state& apply_ctrl(const T2& A1, const arma::uvec& ctrl,
+                         const arma::uvec& subsys) {
+    const auto& A = _internal::as_Mat(A1);
+
+#ifndef QICLIB_NO_DEBUG
+    const arma::uvec ctrlsubsys = arma::join_cols(subsys, ctrl);
+
+    if (A.n_elem == 0)
+      throw Exception("qic::mmap_state::apply", Exception::type::ZERO_SIZE);
+
+    if (A.n_rows != A.n_cols)
+      throw Exception("qic::mmap_state::apply",
+                      Exception::type::MATRIX_NOT_SQUARE);
+
+    if (subsys.n_elem == 0 || ctrlsubsys.n_elem > _dim.n_elem ||
+        arma::unique(ctrlsubsys).eval().n_elem != ctrlsubsys.n_elem ||
+        arma::any(ctrlsubsys > _dim.n_elem) || arma::any(ctrlsubsys == 0))
+      throw Exception("qic::mmap_state::apply",
+                      Exception::type::INVALID_SUBSYS);
+
+    for (arma::uword i = 1; i < ctrl.n_elem; ++i)
+      if (_dim.at(ctrl.at(i) - 1) != _dim.at(ctrl.at(0) - 1))
+        throw Exception("qic::mmap_state::apply",
+                        Exception::type::DIMS_NOT_EQUAL);
+
+    if (arma::prod(_dim(subsys - 1)) != A.n_rows)
+      throw Exception("qic::mmap_state::apply",
+                      Exception::type::DIMS_MISMATCH_MATRIX);
+#endif
+
+    apply_chunked(A, ctrl, subsys);
+    return *this;
+  }
+
+  //****************************************************************************
+
+  template <typename T2, typename = typename std::enable_if<
+                           is_all_same<T1, typename promote_var<
+                                             T1, trait::eT<T2> >::type>::value,
+                           void>::type>
+  mmap_state& apply(const T2& A, const arma::uvec& subsys) {
+    return apply_ctrl(A, {}, subsys);
+  }
+
+  //****************************************************************************
+
+  mmap_state& run(circuit<T1>& c) {
+#ifndef QICLIB_NO_DEBUG
+    if (c.dim().n_elem != _dim.n_elem || arma::any(c.dim() != _dim))
+      throw Exception("qic::mmap_state::run",
+                      Exception::type::DIMS_MISMATCH_MATRIX);
+#endif
+
+    for (const auto& g : c.fused())
+      apply_chunked(g.A, g.ctrl, g.subsys);
+    return *this;
+  }
+
+  //****************************************************************************
+
+  pT norm() const {
+    using aT = typename acc_type<pT>::type;
+
+    auto add = [&](arma::Col<aT>& acc, arma::uword c) {
+      const T1* x = _x + c * _chunk;
+      aT s(0);
+      for (arma::uword i = 0; i < _chunk; ++i)
+        s += static_cast<aT>(std::norm(x[i]));
+      acc.at(0) += s;
+    };
+
+    const auto s = _internal::reduce_sum<arma::Col<aT> >(_nchunk, 1, 1, add);
+    return static_cast<pT>(std::sqrt(s.at(0)));
+  }
+
+  //****************************************************************************
+
+  // Measures subsys in the computational basis and collapses the state in
+  // place, as measure_comp_inplace
+  std::tuple<arma::uword, arma::Col<pT> > measure_comp(arma::uvec subsys) {
+    using aT = typename acc_type<pT>::type;
+
+#ifndef QICLIB_NO_DEBUG
+    if (subsys.n_elem > _dim.n_elem ||
+        arma::unique(subsys).eval().n_elem != subsys.n_elem ||
+        arma::any(subsys > _dim.n_elem) || arma::any(subsys == 0))
+      throw Exception("qic::mmap_state::measure_comp",
+                      Exception::type::INVALID_SUBSYS);
+#endif
+
+    subsys = arma::sort(subsys);
+    const arma::uword m = subsys.n_elem;
+
+    // the leading measured subsystems come first in the outcome, followed
+    // by the DL outcomes of the measured subsystems inside a chunk
+    arma::uword ostride[_internal::MAXQDIT];
+    arma::uword DS(1), nl(0);
+    for (arma::uword j = m; j-- > 0;) {
+      ostride[j] = DS;
+      DS *= _dim.at(subsys.at(j) - 1);
+      if (subsys.at(j) > _split)
+        ++nl;
+    }
+    const arma::uword mh = m - nl;
+    const arma::uword DL = mh > 0 ? ostride[mh - 1] : DS;
+
+    arma::uvec lsub(nl);
+    for (arma::uword j = mh; j < m; ++j)
+      lsub.at(j - mh) = subsys.at(j) - _split;
+    arma::uvec ldim(_dim.n_elem - _split);
+    for (arma::uword i = _split; i < _dim.n_elem; ++i)
+      ldim.at(i - _split) = _dim.at(i);
+
+    auto hoff = [&](arma::uword c) {
+      arma::uword off(0);
+      for (arma::uword j = 0; j < mh; ++j) {
+        const arma::uword x = subsys.at(j) - 1;
+        off += ((c / _hstride[x]) % _dim.at(x)) * ostride[j];
+      }
+      return off;
+    };
+
+    auto add = [&](arma::Col<aT>& acc, arma::uword c) {
+      const arma::Mat<T1> v(_x + c * _chunk, _chunk, 1, false, true);
+      const auto pl = _internal::marginal_prob(v, lsub, ldim);
+      const arma::uword h = hoff(c);
+      for (arma::uword l = 0; l < DL; ++l)
+        acc.at(h + l) += static_cast<aT>(pl.at(l));
+    };
+
+    const auto prob = _internal::as_type<arma::Col<pT> >::from(
+      _internal::reduce_sum<arma::Col<aT> >(_nchunk, DS, 1, add));
+
+    std::discrete_distribution<arma::uword> dd(prob.begin(), prob.end());
+    const arma::uword result = dd(rdevs.rng);
+    const T1 scale = static_cast<T1>(1) / std::sqrt(prob.at(result));
+
+    arma::Col<T1> a(DL, arma::fill::zeros);
+    a.at(result % DL) = scale;
+
+    for (arma::uword c = 0; c < _nchunk; ++c) {
+      T1* x = _x + c * _chunk;
+      if (hoff(c) != result - result % DL) {
+        std::fill(x, x + _chunk, static_cast<T1>(0));
+      } else if (nl == 0) {
+        for (arma::uword i = 0; i < _chunk; ++i)
+          x[i] *= scale;
+      } else {
+        arma::Mat<T1> v(x, _chunk, 1, false, true);
+        _internal::apply_ctrl_diag_kernel(v, a, {}, lsub, ldim);
+      }
+    }
+
+    return std::make_tuple(result, prob);
+  }
+
+  //****************************************************************************
+
+ private:
+  arma::uvec _dim;
+  arma::uword _n{0};
+  int _fd{-1};
+  T1* _x{nullptr};
+  arma::uword _split{0};
+  arma::uword _chunk{0};
+  arma::uword _nchunk{0};
+  arma::uword _hstride[_internal::MAXQDIT]{};
+
+  //****************************************************************************
+
+  void release() noexcept {
+    if (_x != nullptr) {
+      ::msync(_x, _n * sizeof(T1), MS_SYNC);
+      ::munmap(_x, _n * sizeof(T1));
+      _x = nullptr;
+    }
+    if (_fd >= 0) {
+      ::close(_fd);
+      _fd = -1;
+    }
+  }
+
+  //****************************************************************************
+
+  template <typename T2>
+  void apply_chunked(const arma::Mat<T2>& A, const arma::uvec& ctrl,
+                     const arma::uvec& subsys) {
+    const arma::uword n = _dim.n_elem;
+
+    // leading subsystems touched by the gate, in register order
+    bool busy[_internal::MAXQDIT] = {false};
+    for (arma::uword j = 0; j < ctrl.n_elem; ++j)
+      busy[ctrl.at(j) - 1] = true;
+    for (arma::uword j = 0; j < subsys.n_elem; ++j)
+      busy[subsys.at(j) - 1] = true;
+
+    arma::uword hs[_internal::MAXQDIT], pos[_internal::MAXQDIT], nh(0);
+    for (arma::uword i = 0; i < _split; ++i)
+      if (busy[i]) {
+        pos[i] = nh;
+        hs[nh++] = i;
+      }
+
+    // the gathered buffer is the register (dim(hs)..., trailing dims...)
+    arma::uvec gdim(nh + n - _split);
+    for (arma::uword i = 0; i < nh; ++i)
+      gdim.at(i) = _dim.at(hs[i]);
+    for (arma::uword i = _split; i < n; ++i)
+      gdim.at(nh + i - _split) = _dim.at(i);
+
+    auto remap = [&](const arma::uvec& v) {
+      arma::uvec r(v.n_elem);
+      for (arma::uword j = 0; j < v.n_elem; ++j) {
+        const arma::uword x = v.at(j) - 1;
+        r.at(j) = x < _split ? pos[x] + 1 : nh + x - _split + 1;
+      }
+      return r;
+    };
+    const arma::uvec gctrl = remap(ctrl);
+    const arma::uvec gsubsys = remap(subsys);
+
+    if (nh == 0) {
+      for (arma::uword c = 0; c < _nchunk; ++c) {
+        arma::Mat<T1> v(_x + c * _chunk, _chunk, 1, false, true);
+        _internal::apply_ctrl_kernel(v, A, gctrl, gsubsys, gdim);
+      }
+      return;
+    }
+
+    // chunk offsets of the G chunks of a group, relative to its first chunk
+    arma::uword G(1);
+    for (arma::uword i = 0; i < nh; ++i)
+      G *= _dim.at(hs[i]);
+
+    arma::uvec goff(G);
+    for (arma::uword g = 0; g < G; ++g) {
+      arma::uword r(g), off(0);
+      for (arma::uword i = nh; i-- > 0;) {
+        off += (r % _dim.at(hs[i])) * _hstride[hs[i]];
+        r /= _dim.at(hs[i]);
+      }
+      goff.at(g) = off;
+    }
+
+    arma::Mat<T1> buf(G * _chunk, 1);
+    const std::size_t bytes = _chunk * sizeof(T1);
+
+    for (arma::uword c = 0; c < _nchunk; ++c) {
+      bool first = true;
+      for (arma::uword i = 0; i < nh && first; ++i)
+        first = (c / _hstride[hs[i]]) % _dim.at(hs[i]) == 0;
+      if (!first)
+        continue;
+
+      for (arma::uword g = 0; g < G; ++g)
+        std::memcpy(buf.memptr() + g * _chunk, _x + (c + goff.at(g)) * _chunk,
+                    bytes);
+
+      _internal::apply_ctrl_kernel(buf, A, gctrl, gsubsys, gdim);
+
+      for (arma::uword g = 0; g < G; ++g)
+        std::memcpy(_x + (c + goff.at(g)) * _chunk, buf.memptr() + g * _chunk,
+                    bytes);
+    }
+  }
+};
+
+//******************************************************************************
+
+}  // namespace qic
+
+#endif
+
+#endif
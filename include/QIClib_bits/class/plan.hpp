@@ -0,0 +1,330 @@
+/*
+ * QIClib (Quantum information and computation library)
+ *
+ * Copyright (c) 2015 - 2019  Titas Chanda (titas.chanda@gmail.com)
+ *
+ * This file is part of QIClib.
+ *
+ * QIClib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QIClib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QIClib.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _QICLIB_PLAN_HPP_
+#define _QICLIB_PLAN_HPP_
+
+#include "../basic/type_traits.hpp"
+#include "../internal/as_arma.hpp"
+#include "../internal/collapse.hpp"
+#include "../internal/conj2.hpp"
+#include "../internal/lexi.hpp"
+#include "../internal/transpose.hpp"
+#include "exception.hpp"
+#include <armadillo>
+
+namespace qic {
+
+//******************************************************************************
+
+// Partial trace over subsys, set up once for a fixed (subsys, dim). Index I
+// of the register splits as I = offK[K] + offT[T], with K the kept and T the
+// traced part; both offset tables are built by the constructor, so that
+// repeated calls only run the summation.
+//
+//   trx_plan tr({2}, {2, 2, 2});
+//   auto rho_AC = tr(rho);
+
+class trx_plan {
+ public:
+  trx_plan(arma::uvec subsys, arma::uvec dim) {
+#ifndef QICLIB_NO_DEBUG
+    if (dim.n_elem == 0 || arma::any(dim == 0))
+      throw Exception("qic::trx_plan", Exception::type::INVALID_DIMS);
+
+    if (dim.n_elem < subsys.n_elem || arma::any(subsys == 0) ||
+        arma::any(subsys > dim.n_elem) ||
+        subsys.n_elem != arma::unique(subsys).eval().n_elem)
+      throw Exception("qic::trx_plan", Exception::type::INVALID_SUBSYS);
+#endif
+
+    _D = arma::prod(dim);
+    if (subsys.n_elem > 0 && subsys.n_elem < dim.n_elem)
+      _internal::dim_collapse_sys(dim, subsys);
+
+    arma::uvec keep(dim.n_elem - subsys.n_elem);
+    arma::uword keep_count(0);
+    for (arma::uword run = 0; run < dim.n_elem; ++run)
+      if (!arma::any(subsys == run + 1))
+        keep.at(keep_count++) = run + 1;
+
+    _offK = _internal::lexi_offsets(keep, dim);
+    _offT = _internal::lexi_offsets(subsys, dim);
+  }
+
+  //****************************************************************************
+
+  arma::uword n_rows() const noexcept { return _D; }
+
+  arma::uword dimkeep() const noexcept { return _offK.n_elem; }
+
+  //****************************************************************************
+
+  // ret <- Tr_subsys(rho), with rho a density matrix or a state vector; ret
+  // keeps its memory when it already has the right size, and nothing else
+  // is allocated
+  template <typename T1, typename = typename std::enable_if<
+                           is_arma_type_var<T1>::value, void>::type>
+  void execute(const T1& rho1, arma::Mat<trait::eT<T1> >& ret,
+               bool is_Hermitian = false) const {
+    using eT = trait::eT<T1>;
+    using aT = typename acc_type<eT>::type;
+
+    const auto& rho = _internal::as_Mat(rho1);
+    const bool checkV = (rho.n_cols != 1);
+    const arma::uword dk = _offK.n_elem;
+    const arma::uword dt = _offT.n_elem;
+
+#ifndef QICLIB_NO_DEBUG
+    if (checkV && rho.n_rows != rho.n_cols)
+      throw Exception("qic::trx_plan",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+    if (rho.n_rows != _D)
+      throw Exception("qic::trx_plan", Exception::type::DIMS_MISMATCH_MATRIX);
+#endif
+
+    // a state vector is summed as psi psi^dagger, which is Hermitian
+    if (!checkV)
+      is_Hermitian = true;
+
+    ret.set_size(dk, dk);
+
+#if (defined(QICLIB_USE_OPENMP) || defined(QICLIB_USE_OPENMP_TRX)) &&          \
+  defined(_OPENMP)
+#pragma omp parallel for
+#endif
+    for (arma::uword L = 0; L < dk; ++L) {
+      const arma::uword K0 = is_Hermitian ? L : 0;
+      for (arma::uword K = K0; K < dk; ++K) {
+        aT s(0);
+        if (checkV)
+          for (arma::uword T = 0; T < dt; ++T)
+            s += static_cast<aT>(
+              rho.at(_offK.at(K) + _offT.at(T), _offK.at(L) + _offT.at(T)));
+        else
+          for (arma::uword T = 0; T < dt; ++T)
+            s += static_cast<aT>(rho.at(_offK.at(K) + _offT.at(T))) *
+                 static_cast<aT>(
+                   _internal::conj2(rho.at(_offK.at(L) + _offT.at(T))));
+        ret.at(K, L) = static_cast<eT>(s);
+      }
+    }
+
+    if (is_Hermitian)
+      for (arma::uword L = 0; L < dk; ++L)
+        for (arma::uword K = 0; K < L; ++K)
+          ret.at(K, L) = _internal::conj2(ret.at(L, K));
+  }
+
+  //****************************************************************************
+
+  template <typename T1,
+            typename TR = typename std::enable_if<
+              is_arma_type_var<T1>::value, arma::Mat<trait::eT<T1> > >::type>
+  TR operator()(const T1& rho, bool is_Hermitian = false) const {
+    TR ret;
+    execute(rho, ret, is_Hermitian);
+    return ret;
+  }
+
+  //****************************************************************************
+
+ private:
+  arma::uword _D{};
+  arma::uvec _offK{};
+  arma::uvec _offT{};
+};
+
+//******************************************************************************
+
+// Partial transpose on subsys, set up once for a fixed (subsys, dim), with
+// the same index split as trx_plan: ret(K_I + T_I, K_J + T_J) =
+// rho(K_I + T_J, K_J + T_I). A state vector is taken as rho = psi psi^dagger,
+// read element by element without forming it.
+
+class tx_plan {
+ public:
+  tx_plan(arma::uvec subsys, arma::uvec dim) {
+#ifndef QICLIB_NO_DEBUG
+    if (dim.n_elem == 0 || arma::any(dim == 0))
+      throw Exception("qic::tx_plan", Exception::type::INVALID_DIMS);
+
+    if (dim.n_elem < subsys.n_elem || arma::any(subsys == 0) ||
+        arma::any(subsys > dim.n_elem) ||
+        subsys.n_elem != arma::unique(subsys).eval().n_elem)
+      throw Exception("qic::tx_plan", Exception::type::INVALID_SUBSYS);
+#endif
+
+    _D = arma::prod(dim);
+    if (subsys.n_elem > 0 && subsys.n_elem < dim.n_elem)
+      _internal::dim_collapse_sys(dim, subsys);
+
+    arma::uvec keep(dim.n_elem - subsys.n_elem);
+    arma::uword keep_count(0);
+    for (arma::uword run = 0; run < dim.n_elem; ++run)
+      if (!arma::any(subsys == run + 1))
+        keep.at(keep_count++) = run + 1;
+
+    _offK = _internal::lexi_offsets(keep, dim);
+    _offT = _internal::lexi_offsets(subsys, dim);
+  }
+
+  //****************************************************************************
+
+  arma::uword n_rows() const noexcept { return _D; }
+
+  //****************************************************************************
+
+  // ret <- rho^(T_subsys); ret keeps its memory when it already has the
+  // right size, and must not alias rho
+  template <typename T1, typename = typename std::enable_if<
+                           is_arma_type_var<T1>::value, void>::type>
+  void execute(const T1& rho1, arma::Mat<trait::eT<T1> >& ret) const {
+    const auto& rho = _internal::as_Mat(rho1);
+    const bool checkV = (rho.n_cols != 1);
+
+#ifndef QICLIB_NO_DEBUG
+    if (checkV && rho.n_rows != rho.n_cols)
+      throw Exception("qic::tx_plan",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+    if (rho.n_rows != _D)
+      throw Exception("qic::tx_plan", Exception::type::DIMS_MISMATCH_MATRIX);
+#endif
+
+    const arma::uword dk = _offK.n_elem;
+    const arma::uword dt = _offT.n_elem;
+    ret.set_size(_D, _D);
+
+#if defined(_OPENMP)
+#pragma omp parallel for collapse(2)
+#endif
+    for (arma::uword KJ = 0; KJ < dk; ++KJ) {
+      for (arma::uword TJ = 0; TJ < dt; ++TJ) {
+        const arma::uword J = _offK.at(KJ) + _offT.at(TJ);
+        for (arma::uword KI = 0; KI < dk; ++KI)
+          for (arma::uword TI = 0; TI < dt; ++TI) {
+            const arma::uword K = _offK.at(KI) + _offT.at(TJ);
+            const arma::uword L = _offK.at(KJ) + _offT.at(TI);
+            ret.at(_offK.at(KI) + _offT.at(TI), J) =
+              checkV ? rho.at(K, L) : rho.at(K) * _internal::conj2(rho.at(L));
+          }
+      }
+    }
+  }
+
+  //****************************************************************************
+
+  template <typename T1,
+            typename TR = typename std::enable_if<
+              is_arma_type_var<T1>::value, arma::Mat<trait::eT<T1> > >::type>
+  TR operator()(const T1& rho) const {
+    TR ret;
+    execute(rho, ret);
+    return ret;
+  }
+
+  //****************************************************************************
+
+ private:
+  arma::uword _D{};
+  arma::uvec _offK{};
+  arma::uvec _offT{};
+};
+
+//******************************************************************************
+
+// Subsystem permutation, set up once for a fixed (perm, dim), as sysperm.
+// The merged axes, strides and tile counts of the blocked transpose are
+// built by the constructor, for state vectors and for density matrices, so
+// that repeated calls only move the data.
+
+class perm_plan {
+ public:
+  perm_plan(const arma::uvec& perm, const arma::uvec& dim) {
+#ifndef QICLIB_NO_DEBUG
+    const arma::uword n = dim.n_elem;
+
+    if (n == 0 || n > _internal::MAXQDIT || arma::any(dim == 0))
+      throw Exception("qic::perm_plan", Exception::type::INVALID_DIMS);
+
+    if (n != perm.n_elem || arma::any(perm == 0) || arma::any(perm > n) ||
+        perm.n_elem != arma::unique(perm).eval().n_elem)
+      throw Exception("qic::perm_plan", Exception::type::INVALID_PERM);
+#endif
+
+    _D = arma::prod(dim);
+    _vec = _internal::make_sysperm_axes(perm, dim, false);
+    _mat = _internal::make_sysperm_axes(perm, dim, true);
+  }
+
+  //****************************************************************************
+
+  arma::uword n_rows() const noexcept { return _D; }
+
+  //****************************************************************************
+
+  // ret <- sysperm(rho, perm, dim); ret keeps its memory when it already
+  // has the right size, and must not alias rho
+  template <typename T1, typename = typename std::enable_if<
+                           is_arma_type_var<T1>::value, void>::type>
+  void execute(const T1& rho1, arma::Mat<trait::eT<T1> >& ret) const {
+    const auto& rho = _internal::as_Mat(rho1);
+
+#ifndef QICLIB_NO_DEBUG
+    if (rho.n_cols != 1 && rho.n_rows != rho.n_cols)
+      throw Exception("qic::perm_plan",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+    if (rho.n_rows != _D)
+      throw Exception("qic::perm_plan", Exception::type::DIMS_MISMATCH_MATRIX);
+#endif
+
+    ret.set_size(rho.n_rows, rho.n_cols);
+    _internal::permute_axes(rho.memptr(), ret.memptr(),
+                            rho.n_cols == 1 ? _vec : _mat);
+  }
+
+  //****************************************************************************
+
+  template <typename T1,
+            typename TR = typename std::enable_if<
+              is_arma_type_var<T1>::value, arma::Mat<trait::eT<T1> > >::type>
+  TR operator()(const T1& rho) const {
+    TR ret;
+    execute(rho, ret);
+    return ret;
+  }
+
+  //****************************************************************************
+
+ private:
+  arma::uword _D{};
+  _internal::permute_axes_desc _vec;
+  _internal::permute_axes_desc _mat;
+};
+
+//******************************************************************************
+
+}  // namespace qic
+
+#endif
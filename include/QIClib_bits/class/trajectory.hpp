@@ -0,0 +1,337 @@
+/*
+ * QIClib (Quantum information and computation library)
+ *
+ * Copyright (c) 2015 - 2019  Titas Chanda (titas.chanda@gmail.com)
+ *
+ * This file is part of QIClib.
+ *
+ * QIClib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QIClib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QIClib.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _QICLIB_TRAJECTORY_HPP_
+#define _QICLIB_TRAJECTORY_HPP_
+
+#include "../basic/macro.hpp"
+#include "../basic/type_traits.hpp"
+#include "../internal/apply_kernel.hpp"
+#include "../internal/as_arma.hpp"
+#include "../internal/reduce.hpp"
+#include "../internal/sampling.hpp"
+#include "circuit.hpp"
+#include "exception.hpp"
+#include "random_devices.hpp"
+#include <armadillo>
+#include <random>
+#include <vector>
+
+namespace qic {
+
+//******************************************************************************
+
+// Monte-Carlo wave-function (quantum trajectory) simulation of a noisy
+// circuit. Gates are recorded as in circuit, and each Kraus channel
+// {K_k} on subsys is unravelled on a state vector psi by picking the branch
+// k with probability ||K_k psi||^2 and replacing psi by K_k psi / ||K_k psi||.
+// Averages over trajectories reproduce the channel on density matrices,
+// with O(D) memory per trajectory.
+
+template <typename T1, typename Enable = typename std::enable_if<
+                         std::is_floating_point<trait::GPT<T1> >::value,
+                         void>::type>
+class trajectory {
+ public:
+  using pT = trait::GPT<T1>;
+
+  struct channel {
+    std::vector<arma::Mat<T1> > Ks;
+    arma::uvec subsys;
+  };
+
+  //****************************************************************************
+
+  explicit trajectory(arma::uvec dim) : _dim(std::move(dim)) {
+#ifndef QICLIB_NO_DEBUG
+    if (_dim.n_elem == 0 || arma::any(_dim == 0))
+      throw Exception("qic::trajectory", Exception::type::INVALID_DIMS);
+#endif
+    _segs.emplace_back(_dim);
+  }
+
+  trajectory(arma::uword n, arma::uword dim) : _dim(n) {
+#ifndef QICLIB_NO_DEBUG
+    if (n == 0 || dim == 0)
+      throw Exception("qic::trajectory", Exception::type::INVALID_DIMS);
+#endif
+    _dim.fill(dim);
+    _segs.emplace_back(_dim);
+  }
+
+  //****************************************************************************
+
+  template <typename T2, typename = typename std::enable_if<
+                           is_all_same<T1, typename promote_var<
+                                             T1, trait::eT<T2> >::type>::value,
+                           void>::type>
+  trajectory& add_ctrl(const T2& A, arma::uvec ctrl, arma::uvec subsys) {
+    _segs.back().add_ctrl(A, std::move(ctrl), std::move(subsys));
+    return *this;
+  }
+
+  template <typename T2, typename = typename std::enable_if<
+                           is_all_same<T1, typename promote_var<
+                                             T1, trait::eT<T2> >::type>::value,
+                           void>::type>
+  trajectory& add(const T2& A, arma::uvec subsys) {
+    _segs.back().add(A, std::move(subsys));
+    return *this;
+  }
+
+  //****************************************************************************
+
+  template <typename T2, typename = typename std::enable_if<
+                           is_all_same<T1, typename promote_var<
+                                             T1, T2>::type>::value,
+                           void>::type>
+  trajectory& add_channel(const std::vector<arma::Mat<T2> >& Ks,
+                          arma::uvec subsys) {
+#ifndef QICLIB_NO_DEBUG
+    if (Ks.size() == 0)
+      throw Exception("qic::trajectory::add_channel",
+                      Exception::type::ZERO_SIZE);
+
+    for (const auto& k : Ks)
+      if (k.n_rows != k.n_cols)
+        throw Exception("qic::trajectory::add_channel",
+                        Exception::type::MATRIX_NOT_SQUARE);
+
+    for (const auto& k : Ks)
+      if (k.n_rows != Ks[0].n_rows)
+        throw Exception("qic::trajectory::add_channel",
+                        Exception::type::DIMS_NOT_EQUAL);
+
+    if (subsys.n_elem == 0 || subsys.n_elem > _dim.n_elem ||
+        arma::unique(subsys).eval().n_elem != subsys.n_elem ||
+        arma::any(subsys > _dim.n_elem) || arma::any(subsys == 0))
+      throw Exception("qic::trajectory::add_channel",
+                      Exception::type::INVALID_SUBSYS);
+
+    if (arma::prod(_dim(subsys - 1)) != Ks[0].n_rows)
+      throw Exception("qic::trajectory::add_channel",
+                      Exception::type::DIMS_MISMATCH_MATRIX);
+#endif
+
+    channel c;
+    c.subsys = std::move(subsys);
+    for (const auto& k : Ks)
+      c.Ks.push_back(_internal::as_type<arma::Mat<T1> >::from(k));
+
+    _chans.push_back(std::move(c));
+    _segs.emplace_back(_dim);
+    _segs.back().set_fuse_limit(_fuse);
+    return *this;
+  }
+
+  template <typename T2, typename = typename std::enable_if<
+                           is_all_same<T1, typename promote_var<
+                                             T1, T2>::type>::value,
+                           void>::type>
+  trajectory& add_channel(const std::initializer_list<arma::Mat<T2> >& Ks,
+                          arma::uvec subsys) {
+    return add_channel(static_cast<std::vector<arma::Mat<T2> > >(Ks),
+                       std::move(subsys));
+  }
+
+  //****************************************************************************
+
+  // The same single-site channel on every site
+  template <typename T2, typename = typename std::enable_if<
+                           is_all_same<T1, typename promote_var<
+                                             T1, T2>::type>::value,
+                           void>::type>
+  trajectory& add_channel_each(const std::vector<arma::Mat<T2> >& Ks) {
+    for (arma::uword i = 0; i < _dim.n_elem; ++i)
+      add_channel(Ks, {i + 1});
+    return *this;
+  }
+
+  //****************************************************************************
+
+  void set_fuse_limit(arma::uword k) noexcept {
+    _fuse = k;
+    for (auto& seg : _segs)
+      seg.set_fuse_limit(k);
+  }
+
+  arma::uword fuse_limit() const noexcept { return _fuse; }
+
+  const arma::uvec& dim() const noexcept { return _dim; }
+
+  arma::uword n_channels() const noexcept { return _chans.size(); }
+
+  const std::vector<channel>& channels() const noexcept { return _chans; }
+
+  void clear() {
+    _segs.clear();
+    _chans.clear();
+    _segs.emplace_back(_dim);
+    _segs.back().set_fuse_limit(_fuse);
+  }
+
+  void compile() {
+    for (auto& seg : _segs)
+      seg.compile();
+  }
+
+  //****************************************************************************
+
+  // One trajectory, in place, with the branches drawn from rng
+  template <typename RNG> void run(arma::Mat<T1>& psi, RNG& rng) {
+#ifndef QICLIB_NO_DEBUG
+    if (psi.n_elem == 0)
+      throw Exception("qic::trajectory::run", Exception::type::ZERO_SIZE);
+
+    if (psi.n_cols != 1)
+      throw Exception("qic::trajectory::run",
+                      Exception::type::MATRIX_NOT_CVECTOR);
+
+    if (arma::prod(_dim) != psi.n_rows)
+      throw Exception("qic::trajectory::run",
+                      Exception::type::DIMS_MISMATCH_MATRIX);
+#endif
+
+    for (arma::uword i = 0; i < _segs.size(); ++i) {
+      _segs[i].run(psi);
+      if (i < _chans.size())
+        jump(psi, _chans[i], rng);
+    }
+  }
+
+  void run(arma::Mat<T1>& psi) { run(psi, rdevs.rng); }
+
+  //****************************************************************************
+
+  // Mean over ntraj trajectories from psi0 of an n_rows x n_cols estimator,
+  // with add(acc, psi) adding the value for the final state psi to acc.
+  // Trajectories run in parallel, each with its own generator seeded from
+  // the calling thread's rdevs.rng, so that results follow rdevs.set_seed
+  // whatever the thread count.
+  template <typename TM, typename F>
+  TM average(const arma::Mat<T1>& psi0, arma::uword ntraj, arma::uword n_rows,
+             arma::uword n_cols, F&& add) {
+    using rng_type = decltype(rdevs.rng);
+
+#ifndef QICLIB_NO_DEBUG
+    if (ntraj == 0)
+      throw Exception("qic::trajectory::average", Exception::type::ZERO_SIZE);
+#endif
+
+    compile();
+
+    std::vector<RandomDevices::seed_type> seeds(ntraj);
+    for (auto& seed : seeds)
+      seed = rdevs.rng();
+
+    TM acc = _internal::reduce_sum<TM>(
+      ntraj, n_rows, n_cols, [&](TM& part, arma::uword t) {
+        arma::Mat<T1> psi(psi0);
+        rng_type rng(seeds[t]);
+        run(psi, rng);
+        add(part, psi);
+      });
+
+    acc /= static_cast<pT>(ntraj);
+    return acc;
+  }
+
+  //****************************************************************************
+
+  // Trajectory average of the reduced state on subsys (lexi order over
+  // subsys as given)
+  arma::Mat<T1> rdm(const arma::Mat<T1>& psi0, arma::uword ntraj,
+                    arma::uvec subsys) {
+#ifndef QICLIB_NO_DEBUG
+    if (subsys.n_elem == 0 || subsys.n_elem > _dim.n_elem ||
+        arma::unique(subsys).eval().n_elem != subsys.n_elem ||
+        arma::any(subsys > _dim.n_elem) || arma::any(subsys == 0))
+      throw Exception("qic::trajectory::rdm", Exception::type::INVALID_SUBSYS);
+#endif
+
+    using aT = typename acc_type<T1>::type;
+
+    const arma::uword DS = arma::prod(_dim(subsys - 1));
+    return _internal::as_type<arma::Mat<T1> >::from(average<arma::Mat<aT> >(
+      psi0, ntraj, DS, DS, [&](arma::Mat<aT>& acc, const arma::Mat<T1>& psi) {
+        acc += _internal::as_type<arma::Mat<aT> >::from(
+          _internal::reduced_block(psi, subsys, _dim));
+      }));
+  }
+
+  //****************************************************************************
+
+  // Trajectory average of <psi|A|psi>, with A acting on subsys
+  template <typename T2, typename = typename std::enable_if<
+                           is_all_same<pT, trait::pT<T2> >::value, void>::type>
+  pT expect(const arma::Mat<T1>& psi0, arma::uword ntraj, const T2& A1,
+            arma::uvec subsys) {
+    const auto& A = _internal::as_Mat(A1);
+
+#ifndef QICLIB_NO_DEBUG
+    if (A.n_rows != A.n_cols)
+      throw Exception("qic::trajectory::expect",
+                      Exception::type::MATRIX_NOT_SQUARE);
+
+    if (subsys.n_elem == 0 || subsys.n_elem > _dim.n_elem ||
+        arma::any(subsys > _dim.n_elem) || arma::any(subsys == 0) ||
+        arma::prod(_dim(subsys - 1)) != A.n_rows)
+      throw Exception("qic::trajectory::expect",
+                      Exception::type::DIMS_MISMATCH_MATRIX);
+#endif
+
+    return std::real(arma::trace(A * rdm(psi0, ntraj, std::move(subsys))));
+  }
+
+  //****************************************************************************
+
+ private:
+  arma::uvec _dim;
+  std::vector<circuit<T1> > _segs{};
+  std::vector<channel> _chans{};
+  arma::uword _fuse{3};
+
+  //****************************************************************************
+
+  // The branch probabilities only depend on the reduced state on subsys, so
+  // one pass over psi gives all of them and only the sampled branch is
+  // applied
+  template <typename RNG>
+  void jump(arma::Mat<T1>& psi, const channel& c, RNG& rng) const {
+    const arma::Mat<T1> R = _internal::reduced_block(psi, c.subsys, _dim);
+
+    arma::Col<pT> prob(c.Ks.size());
+    for (arma::uword k = 0; k < c.Ks.size(); ++k)
+      prob.at(k) = _internal::outcome_prob(R, c.Ks[k]);
+
+    std::discrete_distribution<arma::uword> dd(prob.begin(), prob.end());
+    const arma::uword k = dd(rng);
+
+    _internal::apply_ctrl_kernel(psi, c.Ks[k], {}, c.subsys, _dim);
+    psi /= std::sqrt(prob.at(k));
+  }
+};
+
+//******************************************************************************
+
+}  // namespace qic
+
+#endif
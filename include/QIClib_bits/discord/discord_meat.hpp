@@ -346,8 +346,9 @@ template <typename T1> inline discord_space<T1>& discord_space<T1>::compute() {
       eye4.eye(dim3, dim3);
     }
 
+    const trx_plan trx(arma::uvec{_subsys}, _dim);
     _internal::TO_PASS<T1> pass(_rho, eye2, eye3, eye4, _dim, _subsys,
-                                _party_no);
+                                _party_no, &trx);
 
     std::vector<double> lb(2);
     std::vector<double> ub(2);
@@ -409,8 +410,9 @@ template <typename T1> inline discord_space<T1>& discord_space<T1>::compute() {
       eye4.eye(dim3, dim3);
     }
 
+    const trx_plan trx(arma::uvec{_subsys}, _dim);
     _internal::TO_PASS<T1> pass(_rho, eye2, eye3, eye4, _dim, _subsys,
-                                _party_no);
+                                _party_no, &trx);
 
     std::vector<double> lb(5);
     std::vector<double> ub(5);
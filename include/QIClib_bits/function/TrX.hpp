@@ -25,15 +25,111 @@
 #include "../basic/type_traits.hpp"
 #include "../class/exception.hpp"
 #include "../internal/as_arma.hpp"
+#include "../internal/bits.hpp"
 #include "../internal/collapse.hpp"
 #include "../internal/conj2.hpp"
 #include "../internal/constants.hpp"
+#include "../internal/lexi.hpp"
 #include <armadillo>
 
 namespace qic {
 
 //******************************************************************************
 
+namespace _internal {
+
+//******************************************************************************
+
+// Reduced state of the pure state psi on the complement of subsys, with
+// dim and subsys as left by dim_collapse_sys. The amplitudes are read as a
+// dimkeep x dimtrace matrix M and the result is M M^dagger, computed by
+// BLAS. When the kept subsystems form one block and no conversion is
+// needed, M is read in place as column-major slices of psi. Otherwise M is
+// gathered APPLY_BLOCK columns at a time, in double precision for single
+// precision states, so the extra memory stays O(dimkeep * APPLY_BLOCK).
+template <typename T1>
+inline arma::Mat<T1> TrX_pure(const arma::Mat<T1>& psi,
+                              const arma::uvec& subsys,
+                              const arma::uvec& dim) {
+  using aT = typename acc_type<T1>::type;
+
+  const arma::uword n = dim.n_elem;
+  const arma::uword dimtrace = arma::prod(dim(subsys - 1));
+  const arma::uword dimkeep = psi.n_elem / dimtrace;
+
+  arma::uvec keep(n - subsys.n_elem);
+  arma::uword keep_count(0);
+  for (arma::uword run = 0; run < n; ++run)
+    if (!arma::any(subsys == run + 1))
+      keep.at(keep_count++) = run + 1;
+
+  if (keep_count == 1 && std::is_same<T1, aT>::value) {
+    arma::uword outer(1);
+    for (arma::uword i = 0; i + 1 < keep.at(0); ++i)
+      outer *= dim.at(i);
+    const arma::uword inner = dimtrace / outer;
+    T1* p = const_cast<T1*>(psi.memptr());
+
+    if (inner == 1) {
+      const arma::Mat<T1> M(p, dimkeep, dimtrace, false, true);
+      return M * M.t();
+    }
+
+    // psi(t1, K, t2) in slices of inner x dimkeep, each adding
+    // (A^dagger A)^T to the result
+    arma::Mat<T1> G(dimkeep, dimkeep, arma::fill::zeros);
+    for (arma::uword t = 0; t < outer; ++t) {
+      const arma::Mat<T1> A(p + t * dimkeep * inner, inner, dimkeep, false,
+                            true);
+      G += A.t() * A;
+    }
+    return G.st();
+  }
+
+  const arma::uvec offK = lexi_offsets(keep, dim);
+
+  arma::uvec tdim(subsys.n_elem), tstride(subsys.n_elem);
+  for (arma::uword j = 0; j < subsys.n_elem; ++j) {
+    tdim.at(j) = dim.at(subsys.at(j) - 1);
+    tstride.at(j) = 1;
+    for (arma::uword i = subsys.at(j); i < n; ++i)
+      tstride.at(j) *= dim.at(i);
+  }
+
+  arma::Mat<aT> G(dimkeep, dimkeep, arma::fill::zeros);
+  arma::Mat<aT> Mb;
+
+  for (arma::uword T0 = 0; T0 < dimtrace; T0 += APPLY_BLOCK) {
+    const arma::uword nb = std::min(APPLY_BLOCK, dimtrace - T0);
+    Mb.set_size(dimkeep, nb);
+
+#if (defined(QICLIB_USE_OPENMP) || defined(QICLIB_USE_OPENMP_TRX)) &&          \
+  defined(_OPENMP)
+#pragma omp parallel for
+#endif
+    for (arma::uword j = 0; j < nb; ++j) {
+      arma::uword T = T0 + j;
+      arma::uword off(0);
+      for (arma::uword k = subsys.n_elem; k-- > 0;) {
+        off += (T % tdim.at(k)) * tstride.at(k);
+        T /= tdim.at(k);
+      }
+      for (arma::uword K = 0; K < dimkeep; ++K)
+        Mb.at(K, j) = static_cast<aT>(psi.at(offK.at(K) + off));
+    }
+
+    G += Mb * Mb.t();
+  }
+
+  return as_type<arma::Mat<T1> >::from(std::move(G));
+}
+
+//******************************************************************************
+
+}  // namespace _internal
+
+//******************************************************************************
+
 template <typename T1,
           typename TR = typename std::enable_if<
             is_arma_type_var<T1>::value, arma::Mat<trait::eT<T1> > >::type>
@@ -78,10 +174,11 @@ inline TR TrX(const T1& rho1, arma::uvec subsys, arma::uvec dim,
       return rho * rho.t();
   }
 
+  _internal::dim_collapse_sys(dim, subsys);
+
   if (!checkV)
-    is_Hermitian = true;
+    return _internal::TrX_pure(rho, subsys, dim);
 
-  _internal::dim_collapse_sys(dim, subsys);
   const arma::uword n = dim.n_elem;
   const arma::uword m = subsys.n_elem;
 
@@ -102,10 +199,31 @@ inline TR TrX(const T1& rho1, arma::uvec subsys, arma::uvec dim,
   for (arma::uword i = 1; i < n; ++i)
     product[n - 1 - i] = product[n - i] * dim.at(n - i);
 
+  // qubit-like registers: the traced and kept digits are bit fields
+  arma::uword shift[_internal::MAXQDIT];
+  const bool pow2 = _internal::pow2_shifts(dim, shift);
+  const arma::uword tmask =
+    pow2 ? _internal::subsys_mask(subsys, dim, shift) : 0;
+  const arma::uword kmask = pow2 ? (rho.n_rows - 1) & ~tmask : 0;
+
   arma::Mat<trait::eT<T1> > tr_rho(dimkeep, dimkeep);
 
-  auto worker = [n, m, checkV, &dim, &keep, &subsys, &product,
+  auto worker = [n, m, pow2, tmask, kmask, &dim, &keep, &subsys, &product,
                  &rho](arma::uword K, arma::uword L) noexcept -> trait::eT<T1> {
+    if (pow2) {
+      const arma::uword I0 = _internal::pdep(K, kmask);
+      const arma::uword J0 = _internal::pdep(L, kmask);
+
+      typename acc_type<trait::eT<T1> >::type ret(0);
+      arma::uword T(0);
+      do {
+        ret += rho.at(I0 | T, J0 | T);
+        T = _internal::next_in_mask(T, tmask);
+      } while (T != 0);
+
+      return static_cast<trait::eT<T1> >(ret);
+    }
+
     arma::uword Kindex[_internal::MAXQDIT];
     arma::uword Lindex[_internal::MAXQDIT];
 
@@ -118,7 +236,8 @@ inline TR TrX(const T1& rho1, arma::uvec subsys, arma::uvec dim,
     Kindex[0] = K;
     Lindex[0] = L;
 
-    trait::eT<T1> ret = static_cast<trait::eT<T1> >(0);
+    // accumulated in double precision for single-precision states
+    typename acc_type<trait::eT<T1> >::type ret(0);
 
     const arma::uword loop_no = m;
     constexpr auto loop_no_buffer = _internal::MAXQDIT + 1;
@@ -144,7 +263,7 @@ inline TR TrX(const T1& rho1, arma::uvec subsys, arma::uvec dim,
         J += product[keep[i] - 1] * Lindex[i];
       }
 
-      ret += checkV ? rho.at(I, J) : rho.at(I) * _internal::conj2(rho.at(J));
+      ret += rho.at(I, J);
 
       ++loop_counter[0];
       while (loop_counter[p1] == MAX[p1]) {
@@ -155,7 +274,7 @@ inline TR TrX(const T1& rho1, arma::uvec subsys, arma::uvec dim,
       }
     }
 
-    return ret;
+    return static_cast<trait::eT<T1> >(ret);
   };
 
   if (is_Hermitian) {
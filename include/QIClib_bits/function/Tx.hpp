@@ -25,6 +25,7 @@
 #include "../basic/type_traits.hpp"
 #include "../class/exception.hpp"
 #include "../internal/as_arma.hpp"
+#include "../internal/bits.hpp"
 #include "../internal/collapse.hpp"
 #include "../internal/conj2.hpp"
 #include "../internal/constants.hpp"
@@ -190,10 +191,26 @@ inline TR Tx(const T1& rho1, arma::uvec subsys, arma::uvec dim,
   for (arma::uword i = 1; i < n; ++i)
     product[n - 1 - i] = product[n - i] * dim.at(n - i);
 
-  auto worker = [n, checkV, &dim, &subsys, &product,
+  // qubit-like registers: the transposed digits are swapped as bit fields
+  arma::uword shift[_internal::MAXQDIT];
+  const bool pow2 = _internal::pow2_shifts(dim, shift);
+  const arma::uword tmask =
+    pow2 ? _internal::subsys_mask(subsys, dim, shift) : 0;
+
+  auto worker = [n, checkV, pow2, tmask, &dim, &subsys, &product,
                  &rho](arma::uword I, arma::uword J) noexcept -> trait::eT<T1> {
     arma::uword K(0), L(0);
 
+    if (pow2) {
+      K = (I & ~tmask) | (J & tmask);
+      L = (J & ~tmask) | (I & tmask);
+
+      if (checkV)
+        return rho.at(K, L);
+      else
+        return rho.at(K) * _internal::conj2(rho.at(L));
+    }
+
     for (arma::uword i = 1; i < n; ++i) {
       arma::uword Iindex = I % dim.at(n - i);
       arma::uword Jindex = J % dim.at(n - i);
@@ -0,0 +1,508 @@
+/*
+ * QIClib (Quantum information and computation library)
+ *
+ * Copyright (c) 2015 - 2019  Titas Chanda (titas.chanda@gmail.com)
+ *
+ * This file is part of QIClib.
+ *
+ * QIClib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QIClib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QIClib.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _QICLIB_APPLY_BATCH_HPP_
+#define _QICLIB_APPLY_BATCH_HPP_
+
+#include "../basic/type_traits.hpp"
+#include "../class/exception.hpp"
+#include "../internal/apply_kernel.hpp"
+#include "../internal/as_arma.hpp"
+#include <armadillo>
+
+namespace qic {
+
+//******************************************************************************
+
+// Batched versions of apply_ctrl and apply, for many states of the same
+// register at once: the columns of a matrix X are independent state
+// vectors, and the slices of a cube are independent state vectors or
+// density matrices. Each gate is then a single pass over the whole batch.
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::pT<T1>, trait::pT<T2> >::value &&
+              is_same_pT_var<T1, T2>::value,
+            arma::Mat<typename eT_promoter_var<T1, T2>::type> >::type>
+
+inline TR apply_ctrl_batch(const T1& X1, const T2& A, arma::uvec ctrl,
+                           arma::uvec subsys, arma::uvec dim) {
+  using eTR = typename eT_promoter_var<T1, T2>::type;
+
+  const auto& X = _internal::as_Mat(X1);
+  const auto& A1 = _internal::as_Mat(A);
+
+#ifndef QICLIB_NO_DEBUG
+  const arma::uword d = ctrl.n_elem > 0 ? dim.at(ctrl.at(0) - 1) : 1;
+  const arma::uvec ctrlsubsys = arma::join_cols(subsys, ctrl);
+
+  if (X.n_elem == 0)
+    throw Exception("qic::apply_ctrl_batch", Exception::type::ZERO_SIZE);
+
+  if (A1.n_elem == 0)
+    throw Exception("qic::apply_ctrl_batch", Exception::type::ZERO_SIZE);
+
+  if (A1.n_rows != A1.n_cols)
+    throw Exception("qic::apply_ctrl_batch",
+                    Exception::type::MATRIX_NOT_SQUARE);
+
+  for (arma::uword i = 1; i < ctrl.n_elem; ++i)
+    if (dim.at(ctrl.at(i) - 1) != d)
+      throw Exception("qic::apply_ctrl_batch", Exception::type::DIMS_NOT_EQUAL);
+
+  if (dim.n_elem == 0 || arma::any(dim == 0))
+    throw Exception("qic::apply_ctrl_batch", Exception::type::INVALID_DIMS);
+
+  if (arma::prod(dim) != X.n_rows)
+    throw Exception("qic::apply_ctrl_batch",
+                    Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (arma::prod(dim(subsys - 1)) != A1.n_rows)
+    throw Exception("qic::apply_ctrl_batch",
+                    Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (ctrlsubsys.n_elem > dim.n_elem ||
+      arma::unique(ctrlsubsys).eval().n_elem != ctrlsubsys.n_elem ||
+      arma::any(ctrlsubsys > dim.n_elem) || arma::any(ctrlsubsys == 0))
+    throw Exception("qic::apply_ctrl_batch", Exception::type::INVALID_SUBSYS);
+#endif
+
+  arma::Mat<eTR> ret = _internal::as_type<arma::Mat<eTR> >::from(X);
+  _internal::apply_ctrl_batch_kernel(ret, A1, ctrl, subsys, dim);
+  return ret;
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::pT<T1>, trait::pT<T2> >::value &&
+              is_same_pT_var<T1, T2>::value,
+            arma::Mat<typename eT_promoter_var<T1, T2>::type> >::type>
+
+inline TR apply_ctrl_batch(const T1& X1, const T2& A, arma::uvec ctrl,
+                           arma::uvec subsys, arma::uword dim = 2) {
+  const auto& X = _internal::as_Mat(X1);
+
+#ifndef QICLIB_NO_DEBUG
+  if (X.n_elem == 0)
+    throw Exception("qic::apply_ctrl_batch", Exception::type::ZERO_SIZE);
+
+  if (dim == 0)
+    throw Exception("qic::apply_ctrl_batch", Exception::type::INVALID_DIMS);
+#endif
+
+  const arma::uword n = static_cast<arma::uword>(
+    QICLIB_ROUND_OFF(std::log(X.n_rows) / std::log(dim)));
+
+  arma::uvec dim2(n);
+  dim2.fill(dim);
+  return apply_ctrl_batch(X, A, std::move(ctrl), std::move(subsys),
+                          std::move(dim2));
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<
+                T1, typename promote_var<T1, trait::eT<T2> >::type>::value,
+            void>::type>
+
+inline TR apply_ctrl_batch_inplace(arma::Mat<T1>& X, const T2& A,
+                                   arma::uvec ctrl, arma::uvec subsys,
+                                   arma::uvec dim) {
+  const auto& A1 = _internal::as_Mat(A);
+
+#ifndef QICLIB_NO_DEBUG
+  const arma::uword d = ctrl.n_elem > 0 ? dim.at(ctrl.at(0) - 1) : 1;
+  const arma::uvec ctrlsubsys = arma::join_cols(subsys, ctrl);
+
+  if (X.n_elem == 0)
+    throw Exception("qic::apply_ctrl_batch_inplace",
+                    Exception::type::ZERO_SIZE);
+
+  if (A1.n_elem == 0)
+    throw Exception("qic::apply_ctrl_batch_inplace",
+                    Exception::type::ZERO_SIZE);
+
+  if (A1.n_rows != A1.n_cols)
+    throw Exception("qic::apply_ctrl_batch_inplace",
+                    Exception::type::MATRIX_NOT_SQUARE);
+
+  for (arma::uword i = 1; i < ctrl.n_elem; ++i)
+    if (dim.at(ctrl.at(i) - 1) != d)
+      throw Exception("qic::apply_ctrl_batch_inplace",
+                      Exception::type::DIMS_NOT_EQUAL);
+
+  if (dim.n_elem == 0 || arma::any(dim == 0))
+    throw Exception("qic::apply_ctrl_batch_inplace",
+                    Exception::type::INVALID_DIMS);
+
+  if (arma::prod(dim) != X.n_rows)
+    throw Exception("qic::apply_ctrl_batch_inplace",
+                    Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (arma::prod(dim(subsys - 1)) != A1.n_rows)
+    throw Exception("qic::apply_ctrl_batch_inplace",
+                    Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (ctrlsubsys.n_elem > dim.n_elem ||
+      arma::unique(ctrlsubsys).eval().n_elem != ctrlsubsys.n_elem ||
+      arma::any(ctrlsubsys > dim.n_elem) || arma::any(ctrlsubsys == 0))
+    throw Exception("qic::apply_ctrl_batch_inplace",
+                    Exception::type::INVALID_SUBSYS);
+#endif
+
+  _internal::apply_ctrl_batch_kernel(X, A1, ctrl, subsys, dim);
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<
+                T1, typename promote_var<T1, trait::eT<T2> >::type>::value,
+            void>::type>
+
+inline TR apply_ctrl_batch_inplace(arma::Mat<T1>& X, const T2& A,
+                                   arma::uvec ctrl, arma::uvec subsys,
+                                   arma::uword dim = 2) {
+#ifndef QICLIB_NO_DEBUG
+  if (X.n_elem == 0)
+    throw Exception("qic::apply_ctrl_batch_inplace",
+                    Exception::type::ZERO_SIZE);
+
+  if (dim == 0)
+    throw Exception("qic::apply_ctrl_batch_inplace",
+                    Exception::type::INVALID_DIMS);
+#endif
+
+  const arma::uword n = static_cast<arma::uword>(
+    QICLIB_ROUND_OFF(std::log(X.n_rows) / std::log(dim)));
+
+  arma::uvec dim2(n);
+  dim2.fill(dim);
+  apply_ctrl_batch_inplace(X, A, std::move(ctrl), std::move(subsys),
+                           std::move(dim2));
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::pT<T1>, trait::pT<T2> >::value &&
+              is_same_pT_var<T1, T2>::value,
+            arma::Mat<typename eT_promoter_var<T1, T2>::type> >::type>
+
+inline TR apply_batch(const T1& X1, const T2& A, arma::uvec subsys,
+                      arma::uvec dim) {
+  return apply_ctrl_batch(X1, A, {}, std::move(subsys), std::move(dim));
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::pT<T1>, trait::pT<T2> >::value &&
+              is_same_pT_var<T1, T2>::value,
+            arma::Mat<typename eT_promoter_var<T1, T2>::type> >::type>
+
+inline TR apply_batch(const T1& X1, const T2& A, arma::uvec subsys,
+                      arma::uword dim = 2) {
+  return apply_ctrl_batch(X1, A, {}, std::move(subsys), dim);
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<
+                T1, typename promote_var<T1, trait::eT<T2> >::type>::value,
+            void>::type>
+
+inline TR apply_batch_inplace(arma::Mat<T1>& X, const T2& A, arma::uvec subsys,
+                              arma::uvec dim) {
+  apply_ctrl_batch_inplace(X, A, {}, std::move(subsys), std::move(dim));
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<
+                T1, typename promote_var<T1, trait::eT<T2> >::type>::value,
+            void>::type>
+
+inline TR apply_batch_inplace(arma::Mat<T1>& X, const T2& A, arma::uvec subsys,
+                              arma::uword dim = 2) {
+  apply_ctrl_batch_inplace(X, A, {}, std::move(subsys), dim);
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<trait::GPT<T1>, trait::pT<T2> >::value,
+            arma::Cube<typename promote_var<T1, trait::eT<T2> >::type> >::type>
+
+inline TR apply_ctrl_batch(const arma::Cube<T1>& rhos, const T2& A,
+                           arma::uvec ctrl, arma::uvec subsys, arma::uvec dim) {
+  using eTR = typename promote_var<T1, trait::eT<T2> >::type;
+
+  const auto& A1 = _internal::as_Mat(A);
+
+#ifndef QICLIB_NO_DEBUG
+  const arma::uword d = ctrl.n_elem > 0 ? dim.at(ctrl.at(0) - 1) : 1;
+  const arma::uvec ctrlsubsys = arma::join_cols(subsys, ctrl);
+
+  if (rhos.n_elem == 0)
+    throw Exception("qic::apply_ctrl_batch", Exception::type::ZERO_SIZE);
+
+  if (A1.n_elem == 0)
+    throw Exception("qic::apply_ctrl_batch", Exception::type::ZERO_SIZE);
+
+  if (rhos.n_cols != 1 && rhos.n_rows != rhos.n_cols)
+    throw Exception("qic::apply_ctrl_batch",
+                    Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (A1.n_rows != A1.n_cols)
+    throw Exception("qic::apply_ctrl_batch",
+                    Exception::type::MATRIX_NOT_SQUARE);
+
+  for (arma::uword i = 1; i < ctrl.n_elem; ++i)
+    if (dim.at(ctrl.at(i) - 1) != d)
+      throw Exception("qic::apply_ctrl_batch", Exception::type::DIMS_NOT_EQUAL);
+
+  if (dim.n_elem == 0 || arma::any(dim == 0))
+    throw Exception("qic::apply_ctrl_batch", Exception::type::INVALID_DIMS);
+
+  if (arma::prod(dim) != rhos.n_rows)
+    throw Exception("qic::apply_ctrl_batch",
+                    Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (arma::prod(dim(subsys - 1)) != A1.n_rows)
+    throw Exception("qic::apply_ctrl_batch",
+                    Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (ctrlsubsys.n_elem > dim.n_elem ||
+      arma::unique(ctrlsubsys).eval().n_elem != ctrlsubsys.n_elem ||
+      arma::any(ctrlsubsys > dim.n_elem) || arma::any(ctrlsubsys == 0))
+    throw Exception("qic::apply_ctrl_batch", Exception::type::INVALID_SUBSYS);
+#endif
+
+  arma::Cube<eTR> ret = arma::conv_to<arma::Cube<eTR> >::from(rhos);
+  _internal::apply_ctrl_cube_kernel(ret, A1, ctrl, subsys, dim);
+  return ret;
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<trait::GPT<T1>, trait::pT<T2> >::value,
+            arma::Cube<typename promote_var<T1, trait::eT<T2> >::type> >::type>
+
+inline TR apply_ctrl_batch(const arma::Cube<T1>& rhos, const T2& A,
+                           arma::uvec ctrl, arma::uvec subsys,
+                           arma::uword dim = 2) {
+#ifndef QICLIB_NO_DEBUG
+  if (rhos.n_elem == 0)
+    throw Exception("qic::apply_ctrl_batch", Exception::type::ZERO_SIZE);
+
+  if (dim == 0)
+    throw Exception("qic::apply_ctrl_batch", Exception::type::INVALID_DIMS);
+#endif
+
+  const arma::uword n = static_cast<arma::uword>(
+    QICLIB_ROUND_OFF(std::log(rhos.n_rows) / std::log(dim)));
+
+  arma::uvec dim2(n);
+  dim2.fill(dim);
+  return apply_ctrl_batch(rhos, A, std::move(ctrl), std::move(subsys),
+                          std::move(dim2));
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<
+                T1, typename promote_var<T1, trait::eT<T2> >::type>::value,
+            void>::type>
+
+inline TR apply_ctrl_batch_inplace(arma::Cube<T1>& rhos, const T2& A,
+                                   arma::uvec ctrl, arma::uvec subsys,
+                                   arma::uvec dim) {
+  const auto& A1 = _internal::as_Mat(A);
+
+#ifndef QICLIB_NO_DEBUG
+  const arma::uword d = ctrl.n_elem > 0 ? dim.at(ctrl.at(0) - 1) : 1;
+  const arma::uvec ctrlsubsys = arma::join_cols(subsys, ctrl);
+
+  if (rhos.n_elem == 0)
+    throw Exception("qic::apply_ctrl_batch_inplace",
+                    Exception::type::ZERO_SIZE);
+
+  if (A1.n_elem == 0)
+    throw Exception("qic::apply_ctrl_batch_inplace",
+                    Exception::type::ZERO_SIZE);
+
+  if (rhos.n_cols != 1 && rhos.n_rows != rhos.n_cols)
+    throw Exception("qic::apply_ctrl_batch_inplace",
+                    Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (A1.n_rows != A1.n_cols)
+    throw Exception("qic::apply_ctrl_batch_inplace",
+                    Exception::type::MATRIX_NOT_SQUARE);
+
+  for (arma::uword i = 1; i < ctrl.n_elem; ++i)
+    if (dim.at(ctrl.at(i) - 1) != d)
+      throw Exception("qic::apply_ctrl_batch_inplace",
+                      Exception::type::DIMS_NOT_EQUAL);
+
+  if (dim.n_elem == 0 || arma::any(dim == 0))
+    throw Exception("qic::apply_ctrl_batch_inplace",
+                    Exception::type::INVALID_DIMS);
+
+  if (arma::prod(dim) != rhos.n_rows)
+    throw Exception("qic::apply_ctrl_batch_inplace",
+                    Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (arma::prod(dim(subsys - 1)) != A1.n_rows)
+    throw Exception("qic::apply_ctrl_batch_inplace",
+                    Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (ctrlsubsys.n_elem > dim.n_elem ||
+      arma::unique(ctrlsubsys).eval().n_elem != ctrlsubsys.n_elem ||
+      arma::any(ctrlsubsys > dim.n_elem) || arma::any(ctrlsubsys == 0))
+    throw Exception("qic::apply_ctrl_batch_inplace",
+                    Exception::type::INVALID_SUBSYS);
+#endif
+
+  _internal::apply_ctrl_cube_kernel(rhos, A1, ctrl, subsys, dim);
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<
+                T1, typename promote_var<T1, trait::eT<T2> >::type>::value,
+            void>::type>
+
+inline TR apply_ctrl_batch_inplace(arma::Cube<T1>& rhos, const T2& A,
+                                   arma::uvec ctrl, arma::uvec subsys,
+                                   arma::uword dim = 2) {
+#ifndef QICLIB_NO_DEBUG
+  if (rhos.n_elem == 0)
+    throw Exception("qic::apply_ctrl_batch_inplace",
+                    Exception::type::ZERO_SIZE);
+
+  if (dim == 0)
+    throw Exception("qic::apply_ctrl_batch_inplace",
+                    Exception::type::INVALID_DIMS);
+#endif
+
+  const arma::uword n = static_cast<arma::uword>(
+    QICLIB_ROUND_OFF(std::log(rhos.n_rows) / std::log(dim)));
+
+  arma::uvec dim2(n);
+  dim2.fill(dim);
+  apply_ctrl_batch_inplace(rhos, A, std::move(ctrl), std::move(subsys),
+                           std::move(dim2));
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<trait::GPT<T1>, trait::pT<T2> >::value,
+            arma::Cube<typename promote_var<T1, trait::eT<T2> >::type> >::type>
+
+inline TR apply_batch(const arma::Cube<T1>& rhos, const T2& A,
+                      arma::uvec subsys, arma::uvec dim) {
+  return apply_ctrl_batch(rhos, A, {}, std::move(subsys), std::move(dim));
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<trait::GPT<T1>, trait::pT<T2> >::value,
+            arma::Cube<typename promote_var<T1, trait::eT<T2> >::type> >::type>
+
+inline TR apply_batch(const arma::Cube<T1>& rhos, const T2& A,
+                      arma::uvec subsys, arma::uword dim = 2) {
+  return apply_ctrl_batch(rhos, A, {}, std::move(subsys), dim);
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<
+                T1, typename promote_var<T1, trait::eT<T2> >::type>::value,
+            void>::type>
+
+inline TR apply_batch_inplace(arma::Cube<T1>& rhos, const T2& A,
+                              arma::uvec subsys, arma::uvec dim) {
+  apply_ctrl_batch_inplace(rhos, A, {}, std::move(subsys), std::move(dim));
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<
+                T1, typename promote_var<T1, trait::eT<T2> >::type>::value,
+            void>::type>
+
+inline TR apply_batch_inplace(arma::Cube<T1>& rhos, const T2& A,
+                              arma::uvec subsys, arma::uword dim = 2) {
+  apply_ctrl_batch_inplace(rhos, A, {}, std::move(subsys), dim);
+}
+
+//******************************************************************************
+
+}  // namespace qic
+
+#endif
@@ -0,0 +1,160 @@
+/*
+ * QIClib (Quantum information and computation library)
+ *
+ * Copyright (c) 2015 - 2019  Titas Chanda (titas.chanda@gmail.com)
+ *
+ * This file is part of QIClib.
+ *
+ * QIClib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QIClib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QIClib.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _QICLIB_APPLY_DIAG_HPP_
+#define _QICLIB_APPLY_DIAG_HPP_
+
+#include "../basic/type_traits.hpp"
+#include "../class/exception.hpp"
+#include "../internal/apply_kernel.hpp"
+#include "../internal/as_arma.hpp"
+#include <armadillo>
+
+namespace qic {
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<
+                T1, typename promote_var<T1, trait::eT<T2> >::type>::value,
+            void>::type>
+
+inline TR apply_diag_inplace(arma::Mat<T1>& rho, const T2& A, arma::uvec subsys,
+                             arma::uvec dim) {
+  const auto& A1 = _internal::as_Mat(A);
+
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::apply_diag_inplace", Exception::type::ZERO_SIZE);
+
+  if (A1.n_elem == 0)
+    throw Exception("qic::apply_diag_inplace", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::apply_diag_inplace",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (A1.n_rows != 1 && A1.n_cols != 1)
+    throw Exception("qic::apply_diag_inplace",
+                    Exception::type::MATRIX_NOT_VECTOR);
+
+  if (dim.n_elem == 0 || arma::any(dim == 0))
+    throw Exception("qic::apply_diag_inplace", Exception::type::INVALID_DIMS);
+
+  if (arma::prod(dim) != rho.n_rows)
+    throw Exception("qic::apply_diag_inplace",
+                    Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (arma::prod(dim(subsys - 1)) != A1.n_elem)
+    throw Exception("qic::apply_diag_inplace",
+                    Exception::type::DIMS_MISMATCH_VECTOR);
+
+  if (subsys.n_elem > dim.n_elem ||
+      arma::unique(subsys).eval().n_elem != subsys.n_elem ||
+      arma::any(subsys > dim.n_elem) || arma::any(subsys == 0))
+    throw Exception("qic::apply_diag_inplace",
+                    Exception::type::INVALID_SUBSYS);
+#endif
+
+  const arma::Col<trait::eT<T2> > a(A1.memptr(), A1.n_elem);
+  _internal::apply_ctrl_diag_kernel(rho, a, {}, subsys, dim);
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<
+                T1, typename promote_var<T1, trait::eT<T2> >::type>::value,
+            void>::type>
+
+inline TR apply_diag_inplace(arma::Mat<T1>& rho, const T2& A, arma::uvec subsys,
+                             arma::uword dim = 2) {
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::apply_diag_inplace", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::apply_diag_inplace",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (dim == 0)
+    throw Exception("qic::apply_diag_inplace", Exception::type::INVALID_DIMS);
+#endif
+
+  const arma::uword n = static_cast<arma::uword>(
+    QICLIB_ROUND_OFF(std::log(rho.n_rows) / std::log(dim)));
+
+  arma::uvec dim2(n);
+  dim2.fill(dim);
+  apply_diag_inplace(rho, A, std::move(subsys), std::move(dim2));
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::pT<T1>, trait::pT<T2> >::value &&
+              is_same_pT_var<T1, T2>::value,
+            arma::Mat<typename eT_promoter_var<T1, T2>::type> >::type>
+
+inline TR apply_diag(const T1& rho1, const T2& A, arma::uvec subsys,
+                     arma::uvec dim) {
+  const auto& rho = _internal::as_Mat(rho1);
+
+  TR ret = _internal::as_type<TR>::from(rho);
+  apply_diag_inplace(ret, A, std::move(subsys), std::move(dim));
+  return ret;
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::pT<T1>, trait::pT<T2> >::value &&
+              is_same_pT_var<T1, T2>::value,
+            arma::Mat<typename eT_promoter_var<T1, T2>::type> >::type>
+
+inline TR apply_diag(const T1& rho1, const T2& A, arma::uvec subsys,
+                     arma::uword dim = 2) {
+  const auto& rho = _internal::as_Mat(rho1);
+
+  TR ret = _internal::as_type<TR>::from(rho);
+  apply_diag_inplace(ret, A, std::move(subsys), dim);
+  return ret;
+}
+
+//******************************************************************************
+
+}  // namespace qic
+
+#endif
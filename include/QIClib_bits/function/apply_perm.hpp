@@ -0,0 +1,205 @@
+/*
+ * QIClib (Quantum information and computation library)
+ *
+ * Copyright (c) 2015 - 2019  Titas Chanda (titas.chanda@gmail.com)
+ *
+ * This file is part of QIClib.
+ *
+ * QIClib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QIClib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QIClib.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _QICLIB_APPLY_PERM_HPP_
+#define _QICLIB_APPLY_PERM_HPP_
+
+#include "../basic/num.hpp"
+#include "../basic/type_traits.hpp"
+#include "../class/exception.hpp"
+#include "../internal/apply_kernel.hpp"
+#include "../internal/as_arma.hpp"
+#include <armadillo>
+#include <functional>
+
+namespace qic {
+
+//******************************************************************************
+
+namespace _internal {
+
+//******************************************************************************
+
+// perm[M] = f(M), M = 0, ..., DS - 1
+inline arma::uvec
+perm_from_map(const std::function<arma::uword(arma::uword)>& f,
+              arma::uword DS) {
+  arma::uvec perm(DS);
+  for (arma::uword M = 0; M < DS; ++M)
+    perm.at(M) = f(M);
+  return perm;
+}
+
+//******************************************************************************
+
+inline bool is_perm(const arma::uvec& perm) {
+  const arma::uword DS = perm.n_elem;
+  arma::Col<arma::uword> hit(DS, arma::fill::zeros);
+  for (arma::uword M = 0; M < DS; ++M)
+    if (perm.at(M) >= DS || hit.at(perm.at(M))++ > 0)
+      return false;
+  return true;
+}
+
+//******************************************************************************
+
+}  // namespace _internal
+
+//******************************************************************************
+
+// Applies the permutation oracle |M> -> |f(M)> on subsys, where M is the
+// index of the joint register of subsys in lexicographical order (the first
+// subsystem being the most significant) and f is a bijection of
+// 0, ..., DS - 1. No matrix is formed: the amplitudes are moved in place
+// along the cycles of f, and only the DS values of f are stored.
+
+template <typename T1, typename TR = typename std::enable_if<
+                         std::is_floating_point<trait::GPT<T1> >::value,
+                         void>::type>
+
+inline TR apply_perm_inplace(arma::Mat<T1>& rho,
+                             const std::function<arma::uword(arma::uword)>& f,
+                             arma::uvec subsys, arma::uvec dim) {
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::apply_perm_inplace", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::apply_perm_inplace",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (dim.n_elem == 0 || arma::any(dim == 0))
+    throw Exception("qic::apply_perm_inplace", Exception::type::INVALID_DIMS);
+
+  if (arma::prod(dim) != rho.n_rows)
+    throw Exception("qic::apply_perm_inplace",
+                    Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (subsys.n_elem == 0 || subsys.n_elem > dim.n_elem ||
+      arma::unique(subsys).eval().n_elem != subsys.n_elem ||
+      arma::any(subsys > dim.n_elem) || arma::any(subsys == 0))
+    throw Exception("qic::apply_perm_inplace",
+                    Exception::type::INVALID_SUBSYS);
+#endif
+
+  arma::uword DS(1);
+  for (arma::uword i = 0; i < subsys.n_elem; ++i)
+    DS *= dim.at(subsys.at(i) - 1);
+
+  const arma::uvec perm = _internal::perm_from_map(f, DS);
+
+#ifndef QICLIB_NO_DEBUG
+  if (!_internal::is_perm(perm))
+    throw Exception("qic::apply_perm_inplace", Exception::type::INVALID_PERM);
+#endif
+
+  _internal::apply_ctrl_perm_kernel(rho, perm, {}, subsys, dim);
+}
+
+//******************************************************************************
+
+template <typename T1, typename TR = typename std::enable_if<
+                         std::is_floating_point<trait::GPT<T1> >::value,
+                         void>::type>
+
+inline TR apply_perm_inplace(arma::Mat<T1>& rho,
+                             const std::function<arma::uword(arma::uword)>& f,
+                             arma::uvec subsys, arma::uword dim = 2) {
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::apply_perm_inplace", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::apply_perm_inplace",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (dim == 0)
+    throw Exception("qic::apply_perm_inplace", Exception::type::INVALID_DIMS);
+#endif
+
+  const arma::uword n = static_cast<arma::uword>(
+    QICLIB_ROUND_OFF(std::log(rho.n_rows) / std::log(dim)));
+
+  arma::uvec dim2(n);
+  dim2.fill(dim);
+  apply_perm_inplace(rho, f, std::move(subsys), std::move(dim2));
+}
+
+//******************************************************************************
+
+template <typename T1, typename TR = typename std::enable_if<
+                         std::is_floating_point<trait::pT<T1> >::value,
+                         arma::Mat<trait::eT<T1> > >::type>
+
+inline TR apply_perm(const T1& rho1,
+                     const std::function<arma::uword(arma::uword)>& f,
+                     arma::uvec subsys, arma::uvec dim) {
+  TR rho(_internal::as_Mat(rho1));
+  apply_perm_inplace(rho, f, std::move(subsys), std::move(dim));
+  return rho;
+}
+
+//******************************************************************************
+
+template <typename T1, typename TR = typename std::enable_if<
+                         std::is_floating_point<trait::pT<T1> >::value,
+                         arma::Mat<trait::eT<T1> > >::type>
+
+inline TR apply_perm(const T1& rho1,
+                     const std::function<arma::uword(arma::uword)>& f,
+                     arma::uvec subsys, arma::uword dim = 2) {
+  TR rho(_internal::as_Mat(rho1));
+  apply_perm_inplace(rho, f, std::move(subsys), dim);
+  return rho;
+}
+
+//******************************************************************************
+
+// Index map of the modular exponentiation oracle |x>|y> -> |x>|y a^x mod N>
+// on a joint register (x, y), with y taking dimy values. Values y >= N are
+// left unchanged, so the map is a bijection whenever gcd(a, N) = 1.
+
+inline std::function<arma::uword(arma::uword)>
+modexp_map(arma::uword a, arma::uword N, arma::uword dimy) {
+#ifndef QICLIB_NO_DEBUG
+  if (N == 0 || dimy < N)
+    throw Exception("qic::modexp_map", Exception::type::OUT_OF_RANGE);
+#endif
+
+  return [a, N, dimy](arma::uword M) {
+    const arma::uword x = M / dimy;
+    const arma::uword y = M % dimy;
+    return y < N ? x * dimy + _internal::mulmod(y, modexp(a, x, N), N)
+                 : M;
+  };
+}
+
+//******************************************************************************
+
+}  // namespace qic
+
+#endif
@@ -25,6 +25,7 @@
 #include "../basic/type_traits.hpp"
 #include "../class/constants.hpp"
 #include "../class/exception.hpp"
+#include "../internal/apply_kernel.hpp"
 #include "../internal/as_arma.hpp"
 #include "../internal/constants.hpp"
 #include "../internal/lexi.hpp"
@@ -95,6 +96,14 @@ inline TR make_ctrl(const T1& A1, arma::uvec ctrl, arma::uvec subsys,
   for (arma::uword i = 0; i <= p_num; ++i)
     Ap.at(i) = _internal::POWM_GEN_INT(A1, i);
 
+  // U starts as the identity, so only the control values with a nontrivial
+  // power of A are written
+  arma::uvec p_act(p_num + 1);
+  arma::uword n_act(0);
+  for (arma::uword p = 1; p < d; ++p)
+    if (!_internal::is_eye_op(Ap.at(p)))
+      p_act.at(n_act++) = p;
+
   auto worker_mix =
     [sizeS, sizeC, DS, &ctrl, &subsys, &dim, &keep, &dimS, &dimK,
      &Ap](arma::uword _p, arma::uword _M, arma::uword _N, arma::uword _R)
@@ -140,8 +149,8 @@ inline TR make_ctrl(const T1& A1, arma::uvec ctrl, arma::uvec subsys,
           auto W = worker_mix(1, M, N, R);
           U.at(std::get<1>(W), std::get<2>(W)) = std::get<0>(W);
         } else
-          for (arma::uword p = 0; p < d; ++p) {
-            auto W = worker_mix(p, M, N, R);
+          for (arma::uword k = 0; k < n_act; ++k) {
+            auto W = worker_mix(p_act.at(k), M, N, R);
             U.at(std::get<1>(W), std::get<2>(W)) = std::get<0>(W);
           }
       }
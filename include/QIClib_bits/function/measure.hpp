@@ -27,6 +27,7 @@
 #include "../class/exception.hpp"
 #include "../class/random_devices.hpp"
 #include "../internal/as_arma.hpp"
+#include "../internal/sampling.hpp"
 #include <armadillo>
 
 namespace qic {
@@ -663,6 +664,960 @@ inline TR measure(const T1& rho1, const T2& U1, arma::uvec subsys,
 
 //******************************************************************************
 
+// measure_one and measure_prob take the same arguments as measure.
+// measure_one returns (outcome, probabilities, post-measurement state) with
+// only the state of the sampled outcome formed, and measure_prob only the
+// probabilities. Operators on subsys read rho once, for the reduced block
+// on subsys, whatever the number of outcomes.
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::pT<T1>, trait::GPT<T2> >::value &&
+              is_all_same<trait::pT<T1>, trait::GPT<T2> >::value,
+            std::tuple<arma::uword, arma::Col<trait::pT<T1> >,
+                       arma::Mat<typename promote_var<trait::eT<T1>,
+                                                      T2>::type> > >::type>
+
+inline TR measure_one(const T1& rho1, const std::vector<arma::Mat<T2> >& Ks) {
+  const auto& rho = _internal::as_Mat(rho1);
+
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::measure_one", Exception::type::ZERO_SIZE);
+
+  if (Ks.size() == 0)
+    throw Exception("qic::measure_one", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::measure_one",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  for (const auto& k : Ks)
+    if ((k.n_rows != k.n_cols) && (k.n_cols != 1))
+      throw Exception("qic::measure_one",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  for (const auto& k : Ks)
+    if ((k.n_rows != Ks[0].n_rows) || (k.n_cols != Ks[0].n_cols))
+      throw Exception("qic::measure_one", Exception::type::DIMS_NOT_EQUAL);
+
+  if (Ks[0].n_rows != rho.n_rows)
+    throw Exception("qic::measure_one", Exception::type::DIMS_MISMATCH_MATRIX);
+#endif
+
+  auto op = [&](arma::uword i) -> const arma::Mat<T2>& { return Ks[i]; };
+  auto prob = _internal::outcome_probs(rho, Ks.size(), op);
+
+  std::discrete_distribution<arma::uword> dd(prob.begin(), prob.end());
+  arma::uword result = dd(rdevs.rng);
+
+  auto outstate = _internal::outcome_state(rho, Ks[result], prob.at(result));
+
+  return std::make_tuple(result, std::move(prob), std::move(outstate));
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::pT<T1>, trait::GPT<T2> >::value &&
+              is_all_same<trait::pT<T1>, trait::GPT<T2> >::value,
+            std::tuple<arma::uword, arma::Col<trait::pT<T1> >,
+                       arma::Mat<typename promote_var<trait::eT<T1>,
+                                                      T2>::type> > >::type>
+
+inline TR measure_one(const T1& rho1,
+                      const std::initializer_list<arma::Mat<T2> >& Ks) {
+  return measure_one(rho1, static_cast<std::vector<arma::Mat<T2> > >(Ks));
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::pT<T1>, trait::GPT<T2> >::value &&
+              is_all_same<trait::pT<T1>, trait::GPT<T2> >::value,
+            std::tuple<arma::uword, arma::Col<trait::pT<T1> >,
+                       arma::Mat<typename promote_var<trait::eT<T1>,
+                                                      T2>::type> > >::type>
+
+inline TR measure_one(const T1& rho1, const arma::field<arma::Mat<T2> >& Ks) {
+  const auto& rho = _internal::as_Mat(rho1);
+
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::measure_one", Exception::type::ZERO_SIZE);
+
+  if (Ks.n_elem == 0)
+    throw Exception("qic::measure_one", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::measure_one",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  for (const auto& k : Ks)
+    if ((k.n_rows != k.n_cols) && (k.n_cols != 1))
+      throw Exception("qic::measure_one",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  for (const auto& k : Ks)
+    if ((k.n_rows != Ks.at(0).n_rows) || (k.n_cols != Ks.at(0).n_cols))
+      throw Exception("qic::measure_one", Exception::type::DIMS_NOT_EQUAL);
+
+  if (Ks.at(0).n_rows != rho.n_rows)
+    throw Exception("qic::measure_one", Exception::type::DIMS_MISMATCH_MATRIX);
+#endif
+
+  auto op = [&](arma::uword i) -> const arma::Mat<T2>& { return Ks.at(i); };
+  auto prob = _internal::outcome_probs(rho, Ks.n_elem, op);
+
+  std::discrete_distribution<arma::uword> dd(prob.begin(), prob.end());
+  arma::uword result = dd(rdevs.rng);
+
+  auto outstate = _internal::outcome_state(rho, Ks.at(result), prob.at(result));
+
+  return std::make_tuple(result, std::move(prob), std::move(outstate));
+}
+
+//******************************************************************************
+
+template <
+  typename T1, typename T2,
+  typename TR = typename std::enable_if<
+    is_floating_point_var<trait::pT<T1>, trait::pT<T2> >::value &&
+      is_same_pT_var<T1, T2>::value,
+    std::tuple<arma::uword, arma::Col<trait::pT<T1> >,
+               arma::Mat<typename eT_promoter_var<T1, T2>::type> > >::type>
+
+inline TR measure_one(const T1& rho1, const T2& U1) {
+  const auto& rho = _internal::as_Mat(rho1);
+  const auto& U = _internal::as_Mat(U1);
+
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::measure_one", Exception::type::ZERO_SIZE);
+
+  if (U.n_elem == 0)
+    throw Exception("qic::measure_one", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::measure_one",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (U.n_rows != rho.n_rows)
+    throw Exception("qic::measure_one", Exception::type::DIMS_MISMATCH_MATRIX);
+#endif
+
+  auto op = [&](arma::uword i) { return arma::Mat<trait::eT<T2> >(U.col(i)); };
+  auto prob = _internal::outcome_probs(rho, U.n_cols, op);
+
+  std::discrete_distribution<arma::uword> dd(prob.begin(), prob.end());
+  arma::uword result = dd(rdevs.rng);
+
+  auto outstate = _internal::outcome_state(
+    rho, arma::Mat<trait::eT<T2> >(U.col(result)), prob.at(result));
+
+  return std::make_tuple(result, std::move(prob), std::move(outstate));
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::pT<T1>, trait::GPT<T2> >::value &&
+              is_all_same<trait::pT<T1>, trait::GPT<T2> >::value,
+            std::tuple<arma::uword, arma::Col<trait::pT<T1> >,
+                       arma::Mat<typename promote_var<trait::eT<T1>,
+                                                      T2>::type> > >::type>
+
+inline TR measure_one(const T1& rho1, const std::vector<arma::Mat<T2> >& Ks,
+                      arma::uvec subsys, arma::uvec dim) {
+  const auto& rho = _internal::as_Mat(rho1);
+  const bool checkV = (rho.n_cols != 1);
+
+#ifndef QICLIB_NO_DEBUG
+  const arma::uword D = arma::prod(dim);
+  const arma::uword Dsys = arma::prod(dim(subsys - 1));
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::measure_one", Exception::type::ZERO_SIZE);
+
+  if (Ks.size() == 0)
+    throw Exception("qic::measure_one", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::measure_one",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  for (const auto& k : Ks)
+    if ((k.n_rows != k.n_cols) && (k.n_cols != 1))
+      throw Exception("qic::measure_one",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  for (const auto& k : Ks)
+    if ((k.n_rows != Ks[0].n_rows) || (k.n_cols != Ks[0].n_cols))
+      throw Exception("qic::measure_one", Exception::type::DIMS_NOT_EQUAL);
+
+  if (dim.n_elem == 0 || arma::any(dim == 0))
+    throw Exception("qic::measure_one", Exception::type::INVALID_DIMS);
+
+  if (D != rho.n_rows)
+    throw Exception("qic::measure_one", Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (Dsys != Ks[0].n_rows)
+    throw Exception("qic::measure_one", Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (subsys.n_elem > dim.n_elem ||
+      arma::unique(subsys).eval().n_elem != subsys.n_elem ||
+      arma::any(subsys > dim.n_elem) || arma::any(subsys == 0))
+    throw Exception("qic::measure_one", Exception::type::INVALID_SUBSYS);
+#endif
+
+  auto op = [&](arma::uword i) -> const arma::Mat<T2>& { return Ks[i]; };
+  auto prob = _internal::outcome_probs(rho, Ks.size(), op, subsys, dim);
+
+  std::discrete_distribution<arma::uword> dd(prob.begin(), prob.end());
+  arma::uword result = dd(rdevs.rng);
+
+  const auto& K = Ks[result];
+  auto outstate = K.n_cols != 1 ? apply(rho, K, subsys, dim)
+                                : apply(rho, (K * K.t()).eval(), subsys, dim);
+  outstate /= checkV ? prob.at(result) : std::sqrt(prob.at(result));
+
+  return std::make_tuple(result, std::move(prob), std::move(outstate));
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::pT<T1>, trait::GPT<T2> >::value &&
+              is_all_same<trait::pT<T1>, trait::GPT<T2> >::value,
+            std::tuple<arma::uword, arma::Col<trait::pT<T1> >,
+                       arma::Mat<typename promote_var<trait::eT<T1>,
+                                                      T2>::type> > >::type>
+
+inline TR measure_one(const T1& rho1, const std::vector<arma::Mat<T2> >& Ks,
+                      arma::uvec subsys, arma::uword dim = 2) {
+  const auto& rho = _internal::as_Mat(rho1);
+
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::measure_one", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::measure_one",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (dim == 0)
+    throw Exception("qic::measure_one", Exception::type::INVALID_DIMS);
+#endif
+
+  const arma::uword n = static_cast<arma::uword>(
+    QICLIB_ROUND_OFF(std::log(rho.n_rows) / std::log(dim)));
+
+  arma::uvec dim2(n);
+  dim2.fill(dim);
+
+  return measure_one(rho, Ks, std::move(subsys), std::move(dim2));
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::pT<T1>, trait::GPT<T2> >::value &&
+              is_all_same<trait::pT<T1>, trait::GPT<T2> >::value,
+            std::tuple<arma::uword, arma::Col<trait::pT<T1> >,
+                       arma::Mat<typename promote_var<trait::eT<T1>,
+                                                      T2>::type> > >::type>
+
+inline TR measure_one(const T1& rho1,
+                      const std::initializer_list<arma::Mat<T2> >& Ks,
+                      arma::uvec subsys, arma::uvec dim) {
+  return measure_one(rho1, static_cast<std::vector<arma::Mat<T2> > >(Ks),
+                     std::move(subsys), std::move(dim));
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::pT<T1>, trait::GPT<T2> >::value &&
+              is_all_same<trait::pT<T1>, trait::GPT<T2> >::value,
+            std::tuple<arma::uword, arma::Col<trait::pT<T1> >,
+                       arma::Mat<typename promote_var<trait::eT<T1>,
+                                                      T2>::type> > >::type>
+
+inline TR measure_one(const T1& rho1,
+                      const std::initializer_list<arma::Mat<T2> >& Ks,
+                      arma::uvec subsys, arma::uword dim = 2) {
+  return measure_one(rho1, static_cast<std::vector<arma::Mat<T2> > >(Ks),
+                     std::move(subsys), dim);
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::pT<T1>, trait::GPT<T2> >::value &&
+              is_all_same<trait::pT<T1>, trait::GPT<T2> >::value,
+            std::tuple<arma::uword, arma::Col<trait::pT<T1> >,
+                       arma::Mat<typename promote_var<trait::eT<T1>,
+                                                      T2>::type> > >::type>
+
+inline TR measure_one(const T1& rho1, const arma::field<arma::Mat<T2> >& Ks,
+                      arma::uvec subsys, arma::uvec dim) {
+  const auto& rho = _internal::as_Mat(rho1);
+  const bool checkV = (rho.n_cols != 1);
+
+#ifndef QICLIB_NO_DEBUG
+  const arma::uword D = arma::prod(dim);
+  const arma::uword Dsys = arma::prod(dim(subsys - 1));
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::measure_one", Exception::type::ZERO_SIZE);
+
+  if (Ks.n_elem == 0)
+    throw Exception("qic::measure_one", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::measure_one",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  for (const auto& k : Ks)
+    if ((k.n_rows != k.n_cols) && (k.n_cols != 1))
+      throw Exception("qic::measure_one",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  for (const auto& k : Ks)
+    if ((k.n_rows != Ks.at(0).n_rows) || (k.n_cols != Ks.at(0).n_cols))
+      throw Exception("qic::measure_one", Exception::type::DIMS_NOT_EQUAL);
+
+  if (dim.n_elem == 0 || arma::any(dim == 0))
+    throw Exception("qic::measure_one", Exception::type::INVALID_DIMS);
+
+  if (D != rho.n_rows)
+    throw Exception("qic::measure_one", Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (Dsys != Ks.at(0).n_rows)
+    throw Exception("qic::measure_one", Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (subsys.n_elem > dim.n_elem ||
+      arma::unique(subsys).eval().n_elem != subsys.n_elem ||
+      arma::any(subsys > dim.n_elem) || arma::any(subsys == 0))
+    throw Exception("qic::measure_one", Exception::type::INVALID_SUBSYS);
+#endif
+
+  auto op = [&](arma::uword i) -> const arma::Mat<T2>& { return Ks.at(i); };
+  auto prob = _internal::outcome_probs(rho, Ks.n_elem, op, subsys, dim);
+
+  std::discrete_distribution<arma::uword> dd(prob.begin(), prob.end());
+  arma::uword result = dd(rdevs.rng);
+
+  const auto& K = Ks.at(result);
+  auto outstate = K.n_cols != 1 ? apply(rho, K, subsys, dim)
+                                : apply(rho, (K * K.t()).eval(), subsys, dim);
+  outstate /= checkV ? prob.at(result) : std::sqrt(prob.at(result));
+
+  return std::make_tuple(result, std::move(prob), std::move(outstate));
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::pT<T1>, trait::GPT<T2> >::value &&
+              is_all_same<trait::pT<T1>, trait::GPT<T2> >::value,
+            std::tuple<arma::uword, arma::Col<trait::pT<T1> >,
+                       arma::Mat<typename promote_var<trait::eT<T1>,
+                                                      T2>::type> > >::type>
+
+inline TR measure_one(const T1& rho1, const arma::field<arma::Mat<T2> >& Ks,
+                      arma::uvec subsys, arma::uword dim = 2) {
+  const auto& rho = _internal::as_Mat(rho1);
+
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::measure_one", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::measure_one",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (dim == 0)
+    throw Exception("qic::measure_one", Exception::type::INVALID_DIMS);
+#endif
+
+  const arma::uword n = static_cast<arma::uword>(
+    QICLIB_ROUND_OFF(std::log(rho.n_rows) / std::log(dim)));
+
+  arma::uvec dim2(n);
+  dim2.fill(dim);
+
+  return measure_one(rho, Ks, std::move(subsys), std::move(dim2));
+}
+
+//******************************************************************************
+
+template <
+  typename T1, typename T2,
+  typename TR = typename std::enable_if<
+    is_floating_point_var<trait::pT<T1>, trait::pT<T2> >::value &&
+      is_same_pT_var<T1, T2>::value,
+    std::tuple<arma::uword, arma::Col<trait::pT<T1> >,
+               arma::Mat<typename eT_promoter_var<T1, T2>::type> > >::type>
+
+inline TR measure_one(const T1& rho1, const T2& U1, arma::uvec subsys,
+                      arma::uvec dim) {
+  const auto& rho = _internal::as_Mat(rho1);
+  const auto& U = _internal::as_Mat(U1);
+  const bool checkV = (rho.n_cols != 1);
+
+#ifndef QICLIB_NO_DEBUG
+  const arma::uword D = arma::prod(dim);
+  const arma::uword Dsys = arma::prod(dim(subsys - 1));
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::measure_one", Exception::type::ZERO_SIZE);
+
+  if (U.n_elem == 0)
+    throw Exception("qic::measure_one", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::measure_one",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (dim.n_elem == 0 || arma::any(dim == 0))
+    throw Exception("qic::measure_one", Exception::type::INVALID_DIMS);
+
+  if (D != rho.n_rows)
+    throw Exception("qic::measure_one", Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (Dsys != U.n_rows)
+    throw Exception("qic::measure_one", Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (subsys.n_elem > dim.n_elem ||
+      arma::unique(subsys).eval().n_elem != subsys.n_elem ||
+      arma::any(subsys > dim.n_elem) || arma::any(subsys == 0))
+    throw Exception("qic::measure_one", Exception::type::INVALID_SUBSYS);
+#endif
+
+  auto op = [&](arma::uword i) { return arma::Mat<trait::eT<T2> >(U.col(i)); };
+  auto prob = _internal::outcome_probs(rho, U.n_cols, op, subsys, dim);
+
+  std::discrete_distribution<arma::uword> dd(prob.begin(), prob.end());
+  arma::uword result = dd(rdevs.rng);
+
+  auto outstate = apply(rho, (U.col(result) * U.col(result).t()).eval(),
+                        subsys, dim);
+  outstate /= checkV ? prob.at(result) : std::sqrt(prob.at(result));
+
+  return std::make_tuple(result, std::move(prob), std::move(outstate));
+}
+
+//******************************************************************************
+
+template <
+  typename T1, typename T2,
+  typename TR = typename std::enable_if<
+    is_floating_point_var<trait::pT<T1>, trait::pT<T2> >::value &&
+      is_same_pT_var<T1, T2>::value,
+    std::tuple<arma::uword, arma::Col<trait::pT<T1> >,
+               arma::Mat<typename eT_promoter_var<T1, T2>::type> > >::type>
+
+inline TR measure_one(const T1& rho1, const T2& U, arma::uvec subsys,
+                      arma::uword dim = 2) {
+  const auto& rho = _internal::as_Mat(rho1);
+
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::measure_one", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::measure_one",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (dim == 0)
+    throw Exception("qic::measure_one", Exception::type::INVALID_DIMS);
+#endif
+
+  const arma::uword n = static_cast<arma::uword>(
+    QICLIB_ROUND_OFF(std::log(rho.n_rows) / std::log(dim)));
+
+  arma::uvec dim2(n);
+  dim2.fill(dim);
+
+  return measure_one(rho, U, std::move(subsys), std::move(dim2));
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::pT<T1>, trait::GPT<T2> >::value &&
+              is_all_same<trait::pT<T1>, trait::GPT<T2> >::value,
+            arma::Col<trait::pT<T1> > >::type>
+
+inline TR measure_prob(const T1& rho1, const std::vector<arma::Mat<T2> >& Ks) {
+  const auto& rho = _internal::as_Mat(rho1);
+
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::measure_prob", Exception::type::ZERO_SIZE);
+
+  if (Ks.size() == 0)
+    throw Exception("qic::measure_prob", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::measure_prob",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  for (const auto& k : Ks)
+    if ((k.n_rows != k.n_cols) && (k.n_cols != 1))
+      throw Exception("qic::measure_prob",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  for (const auto& k : Ks)
+    if ((k.n_rows != Ks[0].n_rows) || (k.n_cols != Ks[0].n_cols))
+      throw Exception("qic::measure_prob", Exception::type::DIMS_NOT_EQUAL);
+
+  if (Ks[0].n_rows != rho.n_rows)
+    throw Exception("qic::measure_prob", Exception::type::DIMS_MISMATCH_MATRIX);
+#endif
+
+  auto op = [&](arma::uword i) -> const arma::Mat<T2>& { return Ks[i]; };
+  auto prob = _internal::outcome_probs(rho, Ks.size(), op);
+
+  return prob;
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::pT<T1>, trait::GPT<T2> >::value &&
+              is_all_same<trait::pT<T1>, trait::GPT<T2> >::value,
+            arma::Col<trait::pT<T1> > >::type>
+
+inline TR measure_prob(const T1& rho1,
+                       const std::initializer_list<arma::Mat<T2> >& Ks) {
+  return measure_prob(rho1, static_cast<std::vector<arma::Mat<T2> > >(Ks));
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::pT<T1>, trait::GPT<T2> >::value &&
+              is_all_same<trait::pT<T1>, trait::GPT<T2> >::value,
+            arma::Col<trait::pT<T1> > >::type>
+
+inline TR measure_prob(const T1& rho1, const arma::field<arma::Mat<T2> >& Ks) {
+  const auto& rho = _internal::as_Mat(rho1);
+
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::measure_prob", Exception::type::ZERO_SIZE);
+
+  if (Ks.n_elem == 0)
+    throw Exception("qic::measure_prob", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::measure_prob",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  for (const auto& k : Ks)
+    if ((k.n_rows != k.n_cols) && (k.n_cols != 1))
+      throw Exception("qic::measure_prob",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  for (const auto& k : Ks)
+    if ((k.n_rows != Ks.at(0).n_rows) || (k.n_cols != Ks.at(0).n_cols))
+      throw Exception("qic::measure_prob", Exception::type::DIMS_NOT_EQUAL);
+
+  if (Ks.at(0).n_rows != rho.n_rows)
+    throw Exception("qic::measure_prob", Exception::type::DIMS_MISMATCH_MATRIX);
+#endif
+
+  auto op = [&](arma::uword i) -> const arma::Mat<T2>& { return Ks.at(i); };
+  auto prob = _internal::outcome_probs(rho, Ks.n_elem, op);
+
+  return prob;
+}
+
+//******************************************************************************
+
+template <
+  typename T1, typename T2,
+  typename TR = typename std::enable_if<
+    is_floating_point_var<trait::pT<T1>, trait::pT<T2> >::value &&
+      is_same_pT_var<T1, T2>::value,
+    arma::Col<trait::pT<T1> > >::type>
+
+inline TR measure_prob(const T1& rho1, const T2& U1) {
+  const auto& rho = _internal::as_Mat(rho1);
+  const auto& U = _internal::as_Mat(U1);
+
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::measure_prob", Exception::type::ZERO_SIZE);
+
+  if (U.n_elem == 0)
+    throw Exception("qic::measure_prob", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::measure_prob",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (U.n_rows != rho.n_rows)
+    throw Exception("qic::measure_prob", Exception::type::DIMS_MISMATCH_MATRIX);
+#endif
+
+  auto op = [&](arma::uword i) { return arma::Mat<trait::eT<T2> >(U.col(i)); };
+  auto prob = _internal::outcome_probs(rho, U.n_cols, op);
+
+  return prob;
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::pT<T1>, trait::GPT<T2> >::value &&
+              is_all_same<trait::pT<T1>, trait::GPT<T2> >::value,
+            arma::Col<trait::pT<T1> > >::type>
+
+inline TR measure_prob(const T1& rho1, const std::vector<arma::Mat<T2> >& Ks,
+                       arma::uvec subsys, arma::uvec dim) {
+  const auto& rho = _internal::as_Mat(rho1);
+
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+  const arma::uword D = arma::prod(dim);
+  const arma::uword Dsys = arma::prod(dim(subsys - 1));
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::measure_prob", Exception::type::ZERO_SIZE);
+
+  if (Ks.size() == 0)
+    throw Exception("qic::measure_prob", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::measure_prob",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  for (const auto& k : Ks)
+    if ((k.n_rows != k.n_cols) && (k.n_cols != 1))
+      throw Exception("qic::measure_prob",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  for (const auto& k : Ks)
+    if ((k.n_rows != Ks[0].n_rows) || (k.n_cols != Ks[0].n_cols))
+      throw Exception("qic::measure_prob", Exception::type::DIMS_NOT_EQUAL);
+
+  if (dim.n_elem == 0 || arma::any(dim == 0))
+    throw Exception("qic::measure_prob", Exception::type::INVALID_DIMS);
+
+  if (D != rho.n_rows)
+    throw Exception("qic::measure_prob", Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (Dsys != Ks[0].n_rows)
+    throw Exception("qic::measure_prob", Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (subsys.n_elem > dim.n_elem ||
+      arma::unique(subsys).eval().n_elem != subsys.n_elem ||
+      arma::any(subsys > dim.n_elem) || arma::any(subsys == 0))
+    throw Exception("qic::measure_prob", Exception::type::INVALID_SUBSYS);
+#endif
+
+  auto op = [&](arma::uword i) -> const arma::Mat<T2>& { return Ks[i]; };
+  auto prob = _internal::outcome_probs(rho, Ks.size(), op, subsys, dim);
+
+  return prob;
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::pT<T1>, trait::GPT<T2> >::value &&
+              is_all_same<trait::pT<T1>, trait::GPT<T2> >::value,
+            arma::Col<trait::pT<T1> > >::type>
+
+inline TR measure_prob(const T1& rho1, const std::vector<arma::Mat<T2> >& Ks,
+                       arma::uvec subsys, arma::uword dim = 2) {
+  const auto& rho = _internal::as_Mat(rho1);
+
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::measure_prob", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::measure_prob",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (dim == 0)
+    throw Exception("qic::measure_prob", Exception::type::INVALID_DIMS);
+#endif
+
+  const arma::uword n = static_cast<arma::uword>(
+    QICLIB_ROUND_OFF(std::log(rho.n_rows) / std::log(dim)));
+
+  arma::uvec dim2(n);
+  dim2.fill(dim);
+
+  return measure_prob(rho, Ks, std::move(subsys), std::move(dim2));
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::pT<T1>, trait::GPT<T2> >::value &&
+              is_all_same<trait::pT<T1>, trait::GPT<T2> >::value,
+            arma::Col<trait::pT<T1> > >::type>
+
+inline TR measure_prob(const T1& rho1,
+                       const std::initializer_list<arma::Mat<T2> >& Ks,
+                       arma::uvec subsys, arma::uvec dim) {
+  return measure_prob(rho1, static_cast<std::vector<arma::Mat<T2> > >(Ks),
+                      std::move(subsys), std::move(dim));
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::pT<T1>, trait::GPT<T2> >::value &&
+              is_all_same<trait::pT<T1>, trait::GPT<T2> >::value,
+            arma::Col<trait::pT<T1> > >::type>
+
+inline TR measure_prob(const T1& rho1,
+                       const std::initializer_list<arma::Mat<T2> >& Ks,
+                       arma::uvec subsys, arma::uword dim = 2) {
+  return measure_prob(rho1, static_cast<std::vector<arma::Mat<T2> > >(Ks),
+                      std::move(subsys), dim);
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::pT<T1>, trait::GPT<T2> >::value &&
+              is_all_same<trait::pT<T1>, trait::GPT<T2> >::value,
+            arma::Col<trait::pT<T1> > >::type>
+
+inline TR measure_prob(const T1& rho1, const arma::field<arma::Mat<T2> >& Ks,
+                       arma::uvec subsys, arma::uvec dim) {
+  const auto& rho = _internal::as_Mat(rho1);
+
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+  const arma::uword D = arma::prod(dim);
+  const arma::uword Dsys = arma::prod(dim(subsys - 1));
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::measure_prob", Exception::type::ZERO_SIZE);
+
+  if (Ks.n_elem == 0)
+    throw Exception("qic::measure_prob", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::measure_prob",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  for (const auto& k : Ks)
+    if ((k.n_rows != k.n_cols) && (k.n_cols != 1))
+      throw Exception("qic::measure_prob",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  for (const auto& k : Ks)
+    if ((k.n_rows != Ks.at(0).n_rows) || (k.n_cols != Ks.at(0).n_cols))
+      throw Exception("qic::measure_prob", Exception::type::DIMS_NOT_EQUAL);
+
+  if (dim.n_elem == 0 || arma::any(dim == 0))
+    throw Exception("qic::measure_prob", Exception::type::INVALID_DIMS);
+
+  if (D != rho.n_rows)
+    throw Exception("qic::measure_prob", Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (Dsys != Ks.at(0).n_rows)
+    throw Exception("qic::measure_prob", Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (subsys.n_elem > dim.n_elem ||
+      arma::unique(subsys).eval().n_elem != subsys.n_elem ||
+      arma::any(subsys > dim.n_elem) || arma::any(subsys == 0))
+    throw Exception("qic::measure_prob", Exception::type::INVALID_SUBSYS);
+#endif
+
+  auto op = [&](arma::uword i) -> const arma::Mat<T2>& { return Ks.at(i); };
+  auto prob = _internal::outcome_probs(rho, Ks.n_elem, op, subsys, dim);
+
+  return prob;
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::pT<T1>, trait::GPT<T2> >::value &&
+              is_all_same<trait::pT<T1>, trait::GPT<T2> >::value,
+            arma::Col<trait::pT<T1> > >::type>
+
+inline TR measure_prob(const T1& rho1, const arma::field<arma::Mat<T2> >& Ks,
+                       arma::uvec subsys, arma::uword dim = 2) {
+  const auto& rho = _internal::as_Mat(rho1);
+
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::measure_prob", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::measure_prob",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (dim == 0)
+    throw Exception("qic::measure_prob", Exception::type::INVALID_DIMS);
+#endif
+
+  const arma::uword n = static_cast<arma::uword>(
+    QICLIB_ROUND_OFF(std::log(rho.n_rows) / std::log(dim)));
+
+  arma::uvec dim2(n);
+  dim2.fill(dim);
+
+  return measure_prob(rho, Ks, std::move(subsys), std::move(dim2));
+}
+
+//******************************************************************************
+
+template <
+  typename T1, typename T2,
+  typename TR = typename std::enable_if<
+    is_floating_point_var<trait::pT<T1>, trait::pT<T2> >::value &&
+      is_same_pT_var<T1, T2>::value,
+    arma::Col<trait::pT<T1> > >::type>
+
+inline TR measure_prob(const T1& rho1, const T2& U1, arma::uvec subsys,
+                       arma::uvec dim) {
+  const auto& rho = _internal::as_Mat(rho1);
+  const auto& U = _internal::as_Mat(U1);
+
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+  const arma::uword D = arma::prod(dim);
+  const arma::uword Dsys = arma::prod(dim(subsys - 1));
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::measure_prob", Exception::type::ZERO_SIZE);
+
+  if (U.n_elem == 0)
+    throw Exception("qic::measure_prob", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::measure_prob",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (dim.n_elem == 0 || arma::any(dim == 0))
+    throw Exception("qic::measure_prob", Exception::type::INVALID_DIMS);
+
+  if (D != rho.n_rows)
+    throw Exception("qic::measure_prob", Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (Dsys != U.n_rows)
+    throw Exception("qic::measure_prob", Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (subsys.n_elem > dim.n_elem ||
+      arma::unique(subsys).eval().n_elem != subsys.n_elem ||
+      arma::any(subsys > dim.n_elem) || arma::any(subsys == 0))
+    throw Exception("qic::measure_prob", Exception::type::INVALID_SUBSYS);
+#endif
+
+  auto op = [&](arma::uword i) { return arma::Mat<trait::eT<T2> >(U.col(i)); };
+  auto prob = _internal::outcome_probs(rho, U.n_cols, op, subsys, dim);
+
+  return prob;
+}
+
+//******************************************************************************
+
+template <
+  typename T1, typename T2,
+  typename TR = typename std::enable_if<
+    is_floating_point_var<trait::pT<T1>, trait::pT<T2> >::value &&
+      is_same_pT_var<T1, T2>::value,
+    arma::Col<trait::pT<T1> > >::type>
+
+inline TR measure_prob(const T1& rho1, const T2& U, arma::uvec subsys,
+                       arma::uword dim = 2) {
+  const auto& rho = _internal::as_Mat(rho1);
+
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::measure_prob", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::measure_prob",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (dim == 0)
+    throw Exception("qic::measure_prob", Exception::type::INVALID_DIMS);
+#endif
+
+  const arma::uword n = static_cast<arma::uword>(
+    QICLIB_ROUND_OFF(std::log(rho.n_rows) / std::log(dim)));
+
+  arma::uvec dim2(n);
+  dim2.fill(dim);
+
+  return measure_prob(rho, U, std::move(subsys), std::move(dim2));
+}
+
+//******************************************************************************
+
 template <typename T1,
           typename TR = typename std::enable_if<
             std::is_floating_point<trait::pT<T1> >::value,
@@ -733,19 +1688,13 @@ inline TR measure_comp(const T1& rho1, arma::uvec subsys, arma::uvec dim) {
     throw Exception("qic::measure_comp", Exception::type::INVALID_SUBSYS);
 #endif
 
-  const arma::uword n = dim.n_elem;
-  const arma::uword m = subsys.n_elem;
+  // outcomes in lexi order of the sorted subsystems
+  auto prob = _internal::marginal_prob(rho, arma::sort(subsys).eval(), dim);
 
-  arma::uvec keep(n - m);
-  arma::uword keep_count(0);
-  for (arma::uword run = 0; run < n; ++run) {
-    if (!arma::any(subsys == run + 1)) {
-      keep.at(keep_count) = run + 1;
-      ++keep_count;
-    }
-  }
+  std::discrete_distribution<arma::uword> dd(prob.begin(), prob.end());
+  arma::uword result = dd(rdevs.rng);
 
-  return measure_comp(TrX(rho, std::move(keep), std::move(dim)));
+  return std::make_tuple(result, std::move(prob));
 }
 
 //******************************************************************************
@@ -781,6 +1730,323 @@ inline TR measure_comp(const T1& rho1, arma::uvec subsys, arma::uword dim = 2) {
 
 //******************************************************************************
 
+// Measures subsys of rho (state vector or density matrix) in the
+// computational basis and collapses rho in place onto the outcome, which is
+// returned with the outcome probabilities. Costs one pass to get the
+// marginal probabilities and one to collapse.
+
+template <typename T1,
+          typename TR = typename std::enable_if<
+            std::is_floating_point<trait::GPT<T1> >::value,
+            std::tuple<arma::uword, arma::Col<trait::GPT<T1> > > >::type>
+
+inline TR measure_comp_inplace(arma::Mat<T1>& rho, arma::uvec subsys,
+                               arma::uvec dim) {
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+  const arma::uword D = arma::prod(dim);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::measure_comp_inplace", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::measure_comp_inplace",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (dim.n_elem == 0 || arma::any(dim == 0))
+    throw Exception("qic::measure_comp_inplace", Exception::type::INVALID_DIMS);
+
+  if (D != rho.n_rows)
+    throw Exception("qic::measure_comp_inplace",
+                    Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (subsys.n_elem > dim.n_elem ||
+      arma::unique(subsys).eval().n_elem != subsys.n_elem ||
+      arma::any(subsys > dim.n_elem) || arma::any(subsys == 0))
+    throw Exception("qic::measure_comp_inplace",
+                    Exception::type::INVALID_SUBSYS);
+#endif
+
+  subsys = arma::sort(subsys);
+  auto prob = _internal::marginal_prob(rho, subsys, dim);
+
+  std::discrete_distribution<arma::uword> dd(prob.begin(), prob.end());
+  arma::uword result = dd(rdevs.rng);
+
+  arma::Col<T1> a(prob.n_elem, arma::fill::zeros);
+  a.at(result) = static_cast<T1>(1) / std::sqrt(prob.at(result));
+  _internal::apply_ctrl_diag_kernel(rho, a, {}, subsys, dim);
+
+  return std::make_tuple(result, std::move(prob));
+}
+
+//******************************************************************************
+
+template <typename T1,
+          typename TR = typename std::enable_if<
+            std::is_floating_point<trait::GPT<T1> >::value,
+            std::tuple<arma::uword, arma::Col<trait::GPT<T1> > > >::type>
+
+inline TR measure_comp_inplace(arma::Mat<T1>& rho, arma::uvec subsys,
+                               arma::uword dim = 2) {
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::measure_comp_inplace", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::measure_comp_inplace",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (dim == 0)
+    throw Exception("qic::measure_comp_inplace", Exception::type::INVALID_DIMS);
+#endif
+
+  const arma::uword n = static_cast<arma::uword>(
+    QICLIB_ROUND_OFF(std::log(rho.n_rows) / std::log(dim)));
+
+  arma::uvec dim2(n);
+  dim2.fill(dim);
+
+  return measure_comp_inplace(rho, std::move(subsys), std::move(dim2));
+}
+
+//******************************************************************************
+
+// Measures subsys of rho in the basis given by the columns of U and
+// collapses rho in place, as measure_comp_inplace
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<
+                T1, typename promote_var<T1, trait::eT<T2> >::type>::value,
+            std::tuple<arma::uword, arma::Col<trait::GPT<T1> > > >::type>
+
+inline TR measure_inplace(arma::Mat<T1>& rho, const T2& U1, arma::uvec subsys,
+                          arma::uvec dim) {
+  const auto& U = _internal::as_Mat(U1);
+
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+  const arma::uword D = arma::prod(dim);
+  const arma::uword Dsys = arma::prod(dim(subsys - 1));
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::measure_inplace", Exception::type::ZERO_SIZE);
+
+  if (U.n_elem == 0)
+    throw Exception("qic::measure_inplace", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::measure_inplace",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (U.n_rows != U.n_cols)
+    throw Exception("qic::measure_inplace", Exception::type::MATRIX_NOT_SQUARE);
+
+  if (dim.n_elem == 0 || arma::any(dim == 0))
+    throw Exception("qic::measure_inplace", Exception::type::INVALID_DIMS);
+
+  if (D != rho.n_rows)
+    throw Exception("qic::measure_inplace",
+                    Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (Dsys != U.n_rows)
+    throw Exception("qic::measure_inplace",
+                    Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (subsys.n_elem > dim.n_elem ||
+      arma::unique(subsys).eval().n_elem != subsys.n_elem ||
+      arma::any(subsys > dim.n_elem) || arma::any(subsys == 0))
+    throw Exception("qic::measure_inplace", Exception::type::INVALID_SUBSYS);
+#endif
+
+  auto prob = _internal::marginal_prob(rho, U, subsys, dim);
+
+  std::discrete_distribution<arma::uword> dd(prob.begin(), prob.end());
+  arma::uword result = dd(rdevs.rng);
+
+  const arma::Mat<trait::eT<T2> > P =
+    U.col(result) * U.col(result).t() / std::sqrt(prob.at(result));
+  _internal::apply_ctrl_kernel(rho, P, {}, subsys, dim);
+
+  return std::make_tuple(result, std::move(prob));
+}
+
+//******************************************************************************
+
+template <typename T1, typename T2,
+          typename TR = typename std::enable_if<
+            is_floating_point_var<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<trait::GPT<T1>, trait::pT<T2> >::value &&
+              is_all_same<
+                T1, typename promote_var<T1, trait::eT<T2> >::type>::value,
+            std::tuple<arma::uword, arma::Col<trait::GPT<T1> > > >::type>
+
+inline TR measure_inplace(arma::Mat<T1>& rho, const T2& U, arma::uvec subsys,
+                          arma::uword dim = 2) {
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::measure_inplace", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::measure_inplace",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (dim == 0)
+    throw Exception("qic::measure_inplace", Exception::type::INVALID_DIMS);
+#endif
+
+  const arma::uword n = static_cast<arma::uword>(
+    QICLIB_ROUND_OFF(std::log(rho.n_rows) / std::log(dim)));
+
+  arma::uvec dim2(n);
+  dim2.fill(dim);
+
+  return measure_inplace(rho, U, std::move(subsys), std::move(dim2));
+}
+
+//******************************************************************************
+
+// nshots computational-basis measurements of the same state, returned as
+// (outcomes, histogram of the outcomes, probabilities). The shots are drawn
+// from an alias table built once, in O(1) each.
+
+template <typename T1,
+          typename TR = typename std::enable_if<
+            std::is_floating_point<trait::pT<T1> >::value,
+            std::tuple<arma::uvec, arma::uvec,
+                       arma::Col<trait::pT<T1> > > >::type>
+
+inline TR measure_comp_shots(const T1& rho1, arma::uword nshots) {
+  const auto& rho = _internal::as_Mat(rho1);
+  const bool checkV = (rho.n_cols != 1);
+
+#ifndef QICLIB_NO_DEBUG
+  if (rho.n_elem == 0)
+    throw Exception("qic::measure_comp_shots", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::measure_comp_shots",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+#endif
+
+  arma::Col<trait::pT<T1> > prob(rho.n_rows);
+
+#if (defined(QICLIB_USE_OPENMP) || defined(QICLIB_USE_OPENMP_MEASURE)) &&      \
+  defined(_OPENMP)
+#pragma omp parallel for
+#endif
+  for (arma::uword i = 0; i < rho.n_rows; ++i) {
+    prob.at(i) =
+      checkV ? std::abs(rho.at(i, i)) : std::pow(std::abs(rho.at(i)), 2);
+  }
+
+  arma::uvec outcomes, counts;
+  _internal::sample_shots(prob, nshots, outcomes, counts);
+
+  return std::make_tuple(std::move(outcomes), std::move(counts),
+                         std::move(prob));
+}
+
+//******************************************************************************
+
+template <typename T1,
+          typename TR = typename std::enable_if<
+            std::is_floating_point<trait::pT<T1> >::value,
+            std::tuple<arma::uvec, arma::uvec,
+                       arma::Col<trait::pT<T1> > > >::type>
+
+inline TR measure_comp_shots(const T1& rho1, arma::uword nshots,
+                             arma::uvec subsys, arma::uvec dim) {
+  const auto& rho = _internal::as_Mat(rho1);
+
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+  const arma::uword D = arma::prod(dim);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::measure_comp_shots", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::measure_comp_shots",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (dim.n_elem == 0 || arma::any(dim == 0))
+    throw Exception("qic::measure_comp_shots",
+                    Exception::type::INVALID_DIMS);
+
+  if (D != rho.n_rows)
+    throw Exception("qic::measure_comp_shots",
+                    Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (subsys.n_elem > dim.n_elem ||
+      arma::unique(subsys).eval().n_elem != subsys.n_elem ||
+      arma::any(subsys > dim.n_elem) || arma::any(subsys == 0))
+    throw Exception("qic::measure_comp_shots",
+                    Exception::type::INVALID_SUBSYS);
+#endif
+
+  // outcomes in lexi order of the measured subsystems, as in measure_comp
+  auto prob = _internal::marginal_prob(rho, arma::sort(subsys).eval(), dim);
+
+  arma::uvec outcomes, counts;
+  _internal::sample_shots(prob, nshots, outcomes, counts);
+
+  return std::make_tuple(std::move(outcomes), std::move(counts),
+                         std::move(prob));
+}
+
+//******************************************************************************
+
+template <typename T1,
+          typename TR = typename std::enable_if<
+            std::is_floating_point<trait::pT<T1> >::value,
+            std::tuple<arma::uvec, arma::uvec,
+                       arma::Col<trait::pT<T1> > > >::type>
+
+inline TR measure_comp_shots(const T1& rho1, arma::uword nshots,
+                             arma::uvec subsys, arma::uword dim = 2) {
+  const auto& rho = _internal::as_Mat(rho1);
+
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::measure_comp_shots", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::measure_comp_shots",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (dim == 0)
+    throw Exception("qic::measure_comp_shots",
+                    Exception::type::INVALID_DIMS);
+#endif
+
+  const arma::uword n = static_cast<arma::uword>(
+    QICLIB_ROUND_OFF(std::log(rho.n_rows) / std::log(dim)));
+
+  arma::uvec dim2(n);
+  dim2.fill(dim);
+
+  return measure_comp_shots(rho, nshots, std::move(subsys), std::move(dim2));
+}
+
+//******************************************************************************
+
 }  // namespace qic
 
 #endif
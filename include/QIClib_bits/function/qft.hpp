@@ -0,0 +1,325 @@
+/*
+ * QIClib (Quantum information and computation library)
+ *
+ * Copyright (c) 2015 - 2019  Titas Chanda (titas.chanda@gmail.com)
+ *
+ * This file is part of QIClib.
+ *
+ * QIClib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QIClib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QIClib.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _QICLIB_QFT_HPP_
+#define _QICLIB_QFT_HPP_
+
+#include "../basic/type_traits.hpp"
+#include "../class/exception.hpp"
+#include "../internal/apply_kernel.hpp"
+#include "../internal/as_arma.hpp"
+#include <armadillo>
+
+namespace qic {
+
+//******************************************************************************
+
+// Quantum Fourier transform on the joint register of subsys (in the given
+// order, the first subsystem being the most significant),
+// |j> -> DS^(-1/2) sum_k exp(2 pi i jk / DS) |k>. rho is a state vector or
+// a density matrix; the transform runs as FFTs over the DS amplitudes of
+// every tuple, O(D log DS) instead of the O(D DS) of a dense DS x DS gate.
+
+template <typename T1, typename TR = typename std::enable_if<
+                         std::is_floating_point<trait::pT<T1> >::value,
+                         arma::Mat<std::complex<trait::pT<T1> > > >::type>
+
+inline TR qft(const T1& rho1, const arma::uvec& subsys,
+              const arma::uvec& dim) {
+  const auto& rho = _internal::as_Mat(rho1);
+
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::qft", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::qft",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (dim.n_elem == 0 || arma::any(dim == 0))
+    throw Exception("qic::qft", Exception::type::INVALID_DIMS);
+
+  if (arma::prod(dim) != rho.n_rows)
+    throw Exception("qic::qft", Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (subsys.n_elem == 0 || subsys.n_elem > dim.n_elem ||
+      arma::unique(subsys).eval().n_elem != subsys.n_elem ||
+      arma::any(subsys > dim.n_elem) || arma::any(subsys == 0))
+    throw Exception("qic::qft", Exception::type::INVALID_SUBSYS);
+#endif
+
+  TR ret(_internal::as_type<TR>::from(rho));
+  _internal::apply_qft_kernel(ret, subsys, dim, false);
+  return ret;
+}
+
+//******************************************************************************
+
+template <typename T1, typename TR = typename std::enable_if<
+                         std::is_floating_point<trait::pT<T1> >::value,
+                         arma::Mat<std::complex<trait::pT<T1> > > >::type>
+
+inline TR qft(const T1& rho1, const arma::uvec& subsys,
+              arma::uword dim = 2) {
+  const auto& rho = _internal::as_Mat(rho1);
+
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::qft", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::qft",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (dim == 0)
+    throw Exception("qic::qft", Exception::type::INVALID_DIMS);
+#endif
+
+  const arma::uword n = static_cast<arma::uword>(
+    QICLIB_ROUND_OFF(std::log(rho.n_rows) / std::log(dim)));
+
+  arma::uvec dim2(n);
+  dim2.fill(dim);
+  return qft(rho, subsys, dim2);
+}
+
+//******************************************************************************
+
+// Inverse of qft
+
+template <typename T1, typename TR = typename std::enable_if<
+                         std::is_floating_point<trait::pT<T1> >::value,
+                         arma::Mat<std::complex<trait::pT<T1> > > >::type>
+
+inline TR iqft(const T1& rho1, const arma::uvec& subsys,
+               const arma::uvec& dim) {
+  const auto& rho = _internal::as_Mat(rho1);
+
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::iqft", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::iqft",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (dim.n_elem == 0 || arma::any(dim == 0))
+    throw Exception("qic::iqft", Exception::type::INVALID_DIMS);
+
+  if (arma::prod(dim) != rho.n_rows)
+    throw Exception("qic::iqft", Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (subsys.n_elem == 0 || subsys.n_elem > dim.n_elem ||
+      arma::unique(subsys).eval().n_elem != subsys.n_elem ||
+      arma::any(subsys > dim.n_elem) || arma::any(subsys == 0))
+    throw Exception("qic::iqft", Exception::type::INVALID_SUBSYS);
+#endif
+
+  TR ret(_internal::as_type<TR>::from(rho));
+  _internal::apply_qft_kernel(ret, subsys, dim, true);
+  return ret;
+}
+
+//******************************************************************************
+
+template <typename T1, typename TR = typename std::enable_if<
+                         std::is_floating_point<trait::pT<T1> >::value,
+                         arma::Mat<std::complex<trait::pT<T1> > > >::type>
+
+inline TR iqft(const T1& rho1, const arma::uvec& subsys,
+               arma::uword dim = 2) {
+  const auto& rho = _internal::as_Mat(rho1);
+
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::iqft", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::iqft",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (dim == 0)
+    throw Exception("qic::iqft", Exception::type::INVALID_DIMS);
+#endif
+
+  const arma::uword n = static_cast<arma::uword>(
+    QICLIB_ROUND_OFF(std::log(rho.n_rows) / std::log(dim)));
+
+  arma::uvec dim2(n);
+  dim2.fill(dim);
+  return iqft(rho, subsys, dim2);
+}
+
+//******************************************************************************
+
+// qft on a complex rho, in place
+
+template <typename T1, typename TR = typename std::enable_if<
+                         std::is_floating_point<trait::GPT<T1> >::value &&
+                           is_complex<T1>::value,
+                         void>::type>
+
+inline TR qft_inplace(arma::Mat<T1>& rho, const arma::uvec& subsys,
+                      const arma::uvec& dim) {
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::qft_inplace", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::qft_inplace",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (dim.n_elem == 0 || arma::any(dim == 0))
+    throw Exception("qic::qft_inplace", Exception::type::INVALID_DIMS);
+
+  if (arma::prod(dim) != rho.n_rows)
+    throw Exception("qic::qft_inplace", Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (subsys.n_elem == 0 || subsys.n_elem > dim.n_elem ||
+      arma::unique(subsys).eval().n_elem != subsys.n_elem ||
+      arma::any(subsys > dim.n_elem) || arma::any(subsys == 0))
+    throw Exception("qic::qft_inplace", Exception::type::INVALID_SUBSYS);
+#endif
+
+  _internal::apply_qft_kernel(rho, subsys, dim, false);
+}
+
+//******************************************************************************
+
+template <typename T1, typename TR = typename std::enable_if<
+                         std::is_floating_point<trait::GPT<T1> >::value &&
+                           is_complex<T1>::value,
+                         void>::type>
+
+inline TR qft_inplace(arma::Mat<T1>& rho, const arma::uvec& subsys,
+                      arma::uword dim = 2) {
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::qft_inplace", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::qft_inplace",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (dim == 0)
+    throw Exception("qic::qft_inplace", Exception::type::INVALID_DIMS);
+#endif
+
+  const arma::uword n = static_cast<arma::uword>(
+    QICLIB_ROUND_OFF(std::log(rho.n_rows) / std::log(dim)));
+
+  arma::uvec dim2(n);
+  dim2.fill(dim);
+  qft_inplace(rho, subsys, dim2);
+}
+
+//******************************************************************************
+
+// iqft on a complex rho, in place
+
+template <typename T1, typename TR = typename std::enable_if<
+                         std::is_floating_point<trait::GPT<T1> >::value &&
+                           is_complex<T1>::value,
+                         void>::type>
+
+inline TR iqft_inplace(arma::Mat<T1>& rho, const arma::uvec& subsys,
+                       const arma::uvec& dim) {
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::iqft_inplace", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::iqft_inplace",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (dim.n_elem == 0 || arma::any(dim == 0))
+    throw Exception("qic::iqft_inplace", Exception::type::INVALID_DIMS);
+
+  if (arma::prod(dim) != rho.n_rows)
+    throw Exception("qic::iqft_inplace", Exception::type::DIMS_MISMATCH_MATRIX);
+
+  if (subsys.n_elem == 0 || subsys.n_elem > dim.n_elem ||
+      arma::unique(subsys).eval().n_elem != subsys.n_elem ||
+      arma::any(subsys > dim.n_elem) || arma::any(subsys == 0))
+    throw Exception("qic::iqft_inplace", Exception::type::INVALID_SUBSYS);
+#endif
+
+  _internal::apply_qft_kernel(rho, subsys, dim, true);
+}
+
+//******************************************************************************
+
+template <typename T1, typename TR = typename std::enable_if<
+                         std::is_floating_point<trait::GPT<T1> >::value &&
+                           is_complex<T1>::value,
+                         void>::type>
+
+inline TR iqft_inplace(arma::Mat<T1>& rho, const arma::uvec& subsys,
+                       arma::uword dim = 2) {
+#ifndef QICLIB_NO_DEBUG
+  const bool checkV = (rho.n_cols != 1);
+
+  if (rho.n_elem == 0)
+    throw Exception("qic::iqft_inplace", Exception::type::ZERO_SIZE);
+
+  if (checkV)
+    if (rho.n_rows != rho.n_cols)
+      throw Exception("qic::iqft_inplace",
+                      Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (dim == 0)
+    throw Exception("qic::iqft_inplace", Exception::type::INVALID_DIMS);
+#endif
+
+  const arma::uword n = static_cast<arma::uword>(
+    QICLIB_ROUND_OFF(std::log(rho.n_rows) / std::log(dim)));
+
+  arma::uvec dim2(n);
+  dim2.fill(dim);
+  iqft_inplace(rho, subsys, dim2);
+}
+
+//******************************************************************************
+
+}  // namespace qic
+
+#endif
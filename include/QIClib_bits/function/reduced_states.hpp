@@ -0,0 +1,311 @@
+/*
+ * QIClib (Quantum information and computation library)
+ *
+ * Copyright (c) 2015 - 2019  Titas Chanda (titas.chanda@gmail.com)
+ *
+ * This file is part of QIClib.
+ *
+ * QIClib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QIClib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QIClib.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _QICLIB_REDUCED_STATES_HPP_
+#define _QICLIB_REDUCED_STATES_HPP_
+
+#include "../basic/type_traits.hpp"
+#include "../class/exception.hpp"
+#include "../internal/as_arma.hpp"
+#include "../internal/bits.hpp"
+#include "../internal/conj2.hpp"
+#include "../internal/constants.hpp"
+#include "../internal/reduce.hpp"
+#include <armadillo>
+
+namespace qic {
+
+//******************************************************************************
+
+namespace _internal {
+
+//******************************************************************************
+
+// All reduced states on the site groups listed as columns of sites (one or
+// two sites each, in ascending order), packed one after another in
+// column-major order, in a single pass over a state vector or the columns
+// of a density matrix. For every column J (digit b on the group) and every
+// digit a on the group, rho(I, J) with I equal to J outside the group is
+// added to entry (a, b) of that group's block. For a state vector,
+// psi(I) psi(J)^* is added instead.
+template <typename T1>
+inline arma::Col<typename acc_type<T1>::type>
+reduced_states_kernel(const arma::Mat<T1>& rho, const arma::uvec& dim,
+                      const arma::umat& sites, const arma::uvec& off,
+                      arma::uword len) {
+  using aT = typename acc_type<T1>::type;
+
+  const bool checkV = (rho.n_cols != 1);
+  const T1* x = rho.memptr();
+  const arma::uword D = rho.n_rows;
+  const arma::uword n = dim.n_elem;
+  const arma::uword ng = sites.n_cols;
+  const bool pair = (sites.n_rows == 2);
+
+  arma::uword stride[MAXQDIT];
+  stride[n - 1] = 1;
+  for (arma::uword i = n - 1; i-- > 0;)
+    stride[i] = stride[i + 1] * dim.at(i + 1);
+
+  // qubit-like registers: the digits of each group form a bit mask, the
+  // joint group index of J is gathered from it in one step, and the indices
+  // I are J with the mask bits stepped through
+  arma::uword shift[MAXQDIT];
+  const bool pow2 = pow2_shifts(dim, shift);
+  arma::uvec gmask(ng, arma::fill::zeros);
+  if (pow2)
+    for (arma::uword g = 0; g < ng; ++g)
+      for (arma::uword j = 0; j < sites.n_rows; ++j)
+        gmask.at(g) |= (dim.at(sites.at(j, g)) - 1) << shift[sites.at(j, g)];
+
+  return reduce_sum<arma::Col<aT> >(
+    D, len, 1, [&](arma::Col<aT>& acc, arma::uword J) {
+      const T1* col = checkV ? x + J * D : x;
+      const aT xJ = checkV ? aT(0) : static_cast<aT>(conj2(x[J]));
+      aT* out = acc.memptr();
+
+      if (pow2) {
+        for (arma::uword g = 0; g < ng; ++g) {
+          const arma::uword mask = gmask.at(g);
+          const arma::uword DG =
+            dim.at(sites.at(0, g)) * (pair ? dim.at(sites.at(1, g)) : 1);
+          const arma::uword I0 = J & ~mask;
+          aT* blk = out + off.at(g) + pext(J, mask) * DG;
+
+          arma::uword y(0);
+          for (arma::uword a = 0; a < DG; ++a) {
+            blk[a] += checkV ? static_cast<aT>(col[I0 | y])
+                             : static_cast<aT>(col[I0 | y]) * xJ;
+            y = next_in_mask(y, mask);
+          }
+        }
+        return;
+      }
+
+      arma::uword digit[MAXQDIT];
+      arma::uword r(J);
+      for (arma::uword i = n; i-- > 0;) {
+        digit[i] = r % dim.at(i);
+        r /= dim.at(i);
+      }
+
+      for (arma::uword g = 0; g < ng; ++g) {
+        const arma::uword k = sites.at(0, g);
+        const arma::uword l = pair ? sites.at(1, g) : k;
+        const arma::uword dk = dim.at(k);
+        const arma::uword dl = pair ? dim.at(l) : 1;
+        const arma::uword bk = digit[k];
+        const arma::uword bl = pair ? digit[l] : 0;
+        const arma::uword DG = dk * dl;
+
+        // first index with the group digits set to zero
+        const arma::uword I0 =
+          J - bk * stride[k] - (pair ? bl * stride[l] : 0);
+        aT* blk = out + off.at(g) + (bk * dl + bl) * DG;
+
+        for (arma::uword ak = 0; ak < dk; ++ak)
+          for (arma::uword al = 0; al < dl; ++al) {
+            const arma::uword I =
+              I0 + ak * stride[k] + (pair ? al * stride[l] : 0);
+            blk[ak * dl + al] += checkV ? static_cast<aT>(col[I])
+                                        : static_cast<aT>(col[I]) * xJ;
+          }
+      }
+    });
+}
+
+//******************************************************************************
+
+}  // namespace _internal
+
+//******************************************************************************
+
+// Reduced states of every single site, ret(i) being the state of subsystem
+// i + 1, all accumulated in one pass over rho
+template <typename T1,
+          typename TR = typename std::enable_if<
+            is_arma_type_var<T1>::value,
+            arma::field<arma::Mat<trait::eT<T1> > > >::type>
+
+inline TR reduced_states_1site(const T1& rho1, const arma::uvec& dim) {
+  const auto& rho = _internal::as_Mat(rho1);
+
+#ifndef QICLIB_NO_DEBUG
+  if (rho.n_elem == 0)
+    throw Exception("qic::reduced_states_1site", Exception::type::ZERO_SIZE);
+
+  if (rho.n_cols != 1 && rho.n_rows != rho.n_cols)
+    throw Exception("qic::reduced_states_1site",
+                    Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (dim.n_elem == 0 || dim.n_elem > _internal::MAXQDIT ||
+      arma::any(dim == 0))
+    throw Exception("qic::reduced_states_1site",
+                    Exception::type::INVALID_DIMS);
+
+  if (arma::prod(dim) != rho.n_rows)
+    throw Exception("qic::reduced_states_1site",
+                    Exception::type::DIMS_MISMATCH_MATRIX);
+#endif
+
+  const arma::uword n = dim.n_elem;
+
+  arma::umat sites(1, n);
+  arma::uvec off(n);
+  arma::uword len(0);
+  for (arma::uword i = 0; i < n; ++i) {
+    sites.at(0, i) = i;
+    off.at(i) = len;
+    len += dim.at(i) * dim.at(i);
+  }
+
+  const auto acc = _internal::reduced_states_kernel(rho, dim, sites, off, len);
+
+  TR ret(n);
+  for (arma::uword i = 0; i < n; ++i) {
+    const arma::uword d = dim.at(i);
+    ret.at(i).set_size(d, d);
+    for (arma::uword j = 0; j < d * d; ++j)
+      ret.at(i).at(j) = static_cast<trait::eT<T1> >(acc.at(off.at(i) + j));
+  }
+
+  return ret;
+}
+
+//******************************************************************************
+
+template <typename T1,
+          typename TR = typename std::enable_if<
+            is_arma_type_var<T1>::value,
+            arma::field<arma::Mat<trait::eT<T1> > > >::type>
+
+inline TR reduced_states_1site(const T1& rho1, arma::uword dim = 2) {
+  const auto& rho = _internal::as_Mat(rho1);
+
+#ifndef QICLIB_NO_DEBUG
+  if (rho.n_elem == 0)
+    throw Exception("qic::reduced_states_1site", Exception::type::ZERO_SIZE);
+
+  if (dim == 0)
+    throw Exception("qic::reduced_states_1site",
+                    Exception::type::INVALID_DIMS);
+#endif
+
+  const arma::uword n = static_cast<arma::uword>(
+    QICLIB_ROUND_OFF(std::log(rho.n_rows) / std::log(dim)));
+
+  arma::uvec dim2(n);
+  dim2.fill(dim);
+  return reduced_states_1site(rho, dim2);
+}
+
+//******************************************************************************
+
+// Reduced states of every pair of sites, ret(i, j) with i < j being the
+// state of subsystems {i + 1, j + 1} (in that order), all accumulated in one
+// pass over rho. The entries with i >= j are left empty.
+template <typename T1,
+          typename TR = typename std::enable_if<
+            is_arma_type_var<T1>::value,
+            arma::field<arma::Mat<trait::eT<T1> > > >::type>
+
+inline TR reduced_states_2site(const T1& rho1, const arma::uvec& dim) {
+  const auto& rho = _internal::as_Mat(rho1);
+
+#ifndef QICLIB_NO_DEBUG
+  if (rho.n_elem == 0)
+    throw Exception("qic::reduced_states_2site", Exception::type::ZERO_SIZE);
+
+  if (rho.n_cols != 1 && rho.n_rows != rho.n_cols)
+    throw Exception("qic::reduced_states_2site",
+                    Exception::type::MATRIX_NOT_SQUARE_OR_CVECTOR);
+
+  if (dim.n_elem < 2 || dim.n_elem > _internal::MAXQDIT ||
+      arma::any(dim == 0))
+    throw Exception("qic::reduced_states_2site",
+                    Exception::type::INVALID_DIMS);
+
+  if (arma::prod(dim) != rho.n_rows)
+    throw Exception("qic::reduced_states_2site",
+                    Exception::type::DIMS_MISMATCH_MATRIX);
+#endif
+
+  const arma::uword n = dim.n_elem;
+  const arma::uword ng = n * (n - 1) / 2;
+
+  arma::umat sites(2, ng);
+  arma::uvec off(ng);
+  arma::uword len(0), g(0);
+  for (arma::uword i = 0; i < n; ++i)
+    for (arma::uword j = i + 1; j < n; ++j, ++g) {
+      sites.at(0, g) = i;
+      sites.at(1, g) = j;
+      off.at(g) = len;
+      len += dim.at(i) * dim.at(i) * dim.at(j) * dim.at(j);
+    }
+
+  const auto acc = _internal::reduced_states_kernel(rho, dim, sites, off, len);
+
+  TR ret(n, n);
+  for (g = 0; g < ng; ++g) {
+    const arma::uword i = sites.at(0, g);
+    const arma::uword j = sites.at(1, g);
+    const arma::uword d = dim.at(i) * dim.at(j);
+    ret.at(i, j).set_size(d, d);
+    for (arma::uword k = 0; k < d * d; ++k)
+      ret.at(i, j).at(k) = static_cast<trait::eT<T1> >(acc.at(off.at(g) + k));
+  }
+
+  return ret;
+}
+
+//******************************************************************************
+
+template <typename T1,
+          typename TR = typename std::enable_if<
+            is_arma_type_var<T1>::value,
+            arma::field<arma::Mat<trait::eT<T1> > > >::type>
+
+inline TR reduced_states_2site(const T1& rho1, arma::uword dim = 2) {
+  const auto& rho = _internal::as_Mat(rho1);
+
+#ifndef QICLIB_NO_DEBUG
+  if (rho.n_elem == 0)
+    throw Exception("qic::reduced_states_2site", Exception::type::ZERO_SIZE);
+
+  if (dim == 0)
+    throw Exception("qic::reduced_states_2site",
+                    Exception::type::INVALID_DIMS);
+#endif
+
+  const arma::uword n = static_cast<arma::uword>(
+    QICLIB_ROUND_OFF(std::log(rho.n_rows) / std::log(dim)));
+
+  arma::uvec dim2(n);
+  dim2.fill(dim);
+  return reduced_states_2site(rho, dim2);
+}
+
+//******************************************************************************
+
+}  // namespace qic
+
+#endif
@@ -26,6 +26,7 @@
 #include "../class/exception.hpp"
 #include "../internal/as_arma.hpp"
 #include "../internal/constants.hpp"
+#include "../internal/transpose.hpp"
 #include <armadillo>
 
 namespace qic {
@@ -165,10 +166,11 @@ template <typename T1,
 inline TR sysperm(const T1& rho1, const arma::uvec& perm,
                   const arma::uvec& dim) {
   const auto& rho = _internal::as_Mat(rho1);
+
+#ifndef QICLIB_NO_DEBUG
   const arma::uword n = dim.n_elem;
   const bool checkV = (rho.n_cols != 1);
 
-#ifndef QICLIB_NO_DEBUG
   if (rho.n_elem == 0)
     throw Exception("qic::sysperm", Exception::type::ZERO_SIZE);
 
@@ -188,75 +190,9 @@ inline TR sysperm(const T1& rho1, const arma::uvec& perm,
     throw Exception("qic::sysperm", Exception::type::INVALID_PERM);
 #endif
 
-  arma::uword productr[_internal::MAXQDIT];
-  productr[n - 1] = 1;
-  for (arma::uword i = 1; i < n; ++i)
-    productr[n - 1 - i] = productr[n - i] * dim.at(perm.at(n - i) - 1);
-
-  if (checkV) {
-    arma::Mat<trait::eT<T1> > rho_ret(rho.n_rows, rho.n_rows);
-
-    auto worker = [n, &dim, &perm, &productr, &rho](
-                    arma::uword I, arma::uword J) noexcept -> trait::eT<T1> {
-      arma::uword Iindex[_internal::MAXQDIT];
-      arma::uword Jindex[_internal::MAXQDIT];
-
-      for (arma::uword i = 1; i < n; ++i) {
-        Iindex[n - i] = I % dim.at(n - i);
-        Jindex[n - i] = J % dim.at(n - i);
-        I /= dim.at(n - i);
-        J /= dim.at(n - i);
-      }
-      Iindex[0] = I;
-      Jindex[0] = J;
-
-      arma::uword K(0), L(0);
-      for (arma::uword i = 0; i < n; ++i) {
-        K += productr[i] * Iindex[perm.at(i) - 1];
-        L += productr[i] * Jindex[perm.at(i) - 1];
-      }
-
-      return rho.at(K, L);
-    };
-
-#if defined(_OPENMP)
-#pragma omp parallel for collapse(2)
-#endif
-    for (arma::uword JJ = 0; JJ < rho.n_rows; ++JJ) {
-      for (arma::uword II = 0; II < rho.n_rows; ++II)
-        rho_ret.at(JJ, II) = worker(JJ, II);
-    }
-
-    return rho_ret;
-
-  } else {
-    arma::Col<trait::eT<T1> > rho_ret(rho.n_rows);
-
-    auto worker = [n, &dim, &perm, &productr, &rho](arma::uword I)
-                    noexcept -> trait::eT<T1> {
-      arma::uword Iindex[_internal::MAXQDIT];
-
-      for (arma::uword i = 1; i < n; ++i) {
-        Iindex[n - i] = I % dim.at(n - i);
-        I /= dim.at(n - i);
-      }
-      Iindex[0] = I;
-
-      arma::uword K(0);
-      for (arma::uword i = 0; i < n; ++i) {
-        K += productr[i] * Iindex[perm.at(i) - 1];
-      }
-
-      return rho.at(K);
-    };
-
-#if defined(_OPENMP)
-#pragma omp parallel for
-#endif
-    for (arma::uword II = 0; II < rho.n_rows; ++II) rho_ret.at(II) = worker(II);
-
-    return rho_ret;
-  }
+  arma::Mat<trait::eT<T1> > rho_ret;
+  _internal::sysperm_kernel(rho, rho_ret, perm, dim);
+  return rho_ret;
 }
 
 //******************************************************************************
@@ -0,0 +1,801 @@
+/*
+ * QIClib (Quantum information and computation library)
+ *
+ * Copyright (c) 2015 - 2019  Titas Chanda (titas.chanda@gmail.com)
+ *
+ * This file is part of QIClib.
+ *
+ * QIClib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QIClib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QIClib.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _QICLIB_INTERNAL_APPLY_KERNEL_HPP_
+#define _QICLIB_INTERNAL_APPLY_KERNEL_HPP_
+
+#include "../basic/macro.hpp"
+#include "apply_simd.hpp"
+#include "as_arma.hpp"
+#include "bits.hpp"
+#include "conj2.hpp"
+#include "constants.hpp"
+#include "lexi.hpp"
+#include <armadillo>
+
+namespace qic {
+
+//************************************************************************
+
+namespace _internal {
+
+//******************************************************************************
+
+// Stride description of a local operator acting on the subsystems "subsys"
+// of a register with dimensions "dim". The DS amplitudes touched by one
+// application of the operator sit at base + off[M], M = 0, ..., DS - 1,
+// where base runs over all values of the free (spectator) axes. Adjacent
+// spectator subsystems are merged into one free axis, and the free axes are
+// ordered by decreasing stride, so the innermost loop walks the axis with
+// the smallest stride. When all free dimensions are powers of two (always
+// the case for qubits), fshift[i] = log2(fdim[i]) and base decomposition
+// uses shifts and masks instead of division.
+
+struct apply_strides {
+  arma::uvec off;
+  arma::uword fdim[MAXQDIT + 2];
+  arma::uword fstride[MAXQDIT + 2];
+  arma::uword fshift[MAXQDIT + 2];
+  bool pow2;
+  arma::uword nf;
+  arma::uword nbase;
+  arma::uword ctrl_stride;
+};
+
+//******************************************************************************
+
+inline void push_free_axis(apply_strides& st, arma::uword d,
+                           arma::uword stride) noexcept {
+  if (d == 1)
+    return;
+
+  arma::uword pos = st.nf;
+  while (pos > 0 && st.fstride[pos - 1] < stride) {
+    st.fdim[pos] = st.fdim[pos - 1];
+    st.fstride[pos] = st.fstride[pos - 1];
+    st.fshift[pos] = st.fshift[pos - 1];
+    --pos;
+  }
+  st.fdim[pos] = d;
+  st.fstride[pos] = stride;
+  st.fshift[pos] = log2_pow2(d);
+  st.pow2 = st.pow2 && is_pow2(d);
+  ++st.nf;
+  st.nbase *= d;
+}
+
+//******************************************************************************
+
+inline apply_strides make_apply_strides(const arma::uvec& ctrl,
+                                        const arma::uvec& subsys,
+                                        const arma::uvec& dim,
+                                        arma::uword scale = 1) {
+  const arma::uword n = dim.n_elem;
+
+  arma::uword product[MAXQDIT];
+  product[n - 1] = scale;
+  for (arma::uword i = 1; i < n; ++i)
+    product[n - 1 - i] = product[n - i] * dim.at(n - i);
+
+  bool busy[MAXQDIT] = {false};
+  for (arma::uword i = 0; i < subsys.n_elem; ++i)
+    busy[subsys.at(i) - 1] = true;
+  for (arma::uword i = 0; i < ctrl.n_elem; ++i)
+    busy[ctrl.at(i) - 1] = true;
+
+  apply_strides st;
+  st.pow2 = true;
+  st.nf = 0;
+  st.nbase = 1;
+
+  st.ctrl_stride = 0;
+  for (arma::uword i = 0; i < ctrl.n_elem; ++i)
+    st.ctrl_stride += product[ctrl.at(i) - 1];
+
+  arma::uvec dimS(subsys.n_elem);
+  for (arma::uword i = 0; i < subsys.n_elem; ++i)
+    dimS.at(i) = dim.at(subsys.at(i) - 1);
+
+  arma::uword DS(1);
+  for (arma::uword i = 0; i < subsys.n_elem; ++i)
+    DS *= dimS.at(i);
+
+  st.off.set_size(DS);
+  arma::uword indexS[MAXQDIT];
+  for (arma::uword M = 0; M < DS; ++M) {
+    num_to_lexi(M, dimS, indexS);
+    arma::uword I(0);
+    for (arma::uword i = 0; i < subsys.n_elem; ++i)
+      I += product[subsys.at(i) - 1] * indexS[i];
+    st.off.at(M) = I;
+  }
+
+  arma::uword run_dim(1), run_stride(0);
+  for (arma::uword i = 0; i < n; ++i) {
+    if (dim.at(i) == 1)
+      continue;
+
+    if (busy[i]) {
+      push_free_axis(st, run_dim, run_stride);
+      run_dim = 1;
+    } else {
+      run_dim *= dim.at(i);
+      run_stride = product[i];
+    }
+  }
+  push_free_axis(st, run_dim, run_stride);
+
+  return st;
+}
+
+//******************************************************************************
+
+inline arma::uword outer_base(const apply_strides& st, arma::uword R) noexcept {
+  arma::uword base(0);
+  if (st.nf < 2)
+    return base;
+
+  if (st.pow2) {
+    for (arma::uword i = st.nf - 1; i-- > 0;) {
+      base += (R & (st.fdim[i] - 1)) * st.fstride[i];
+      R >>= st.fshift[i];
+    }
+    return base;
+  }
+
+  for (arma::uword i = st.nf - 1; i-- > 0;) {
+    base += (R % st.fdim[i]) * st.fstride[i];
+    R /= st.fdim[i];
+  }
+  return base;
+}
+
+//******************************************************************************
+
+// The innermost free axis is cut into runs of at most APPLY_BLOCK tuples, so
+// that the parallel loop has enough iterations even when all spectator
+// subsystems merge into a single axis.
+inline arma::uword run_base(const apply_strides& st, arma::uword RC,
+                            arma::uword& len) noexcept {
+  const arma::uword inner = st.nf > 0 ? st.fdim[st.nf - 1] : 1;
+  const arma::uword istride = st.nf > 0 ? st.fstride[st.nf - 1] : 0;
+  const arma::uword nchunk = (inner + APPLY_BLOCK - 1) / APPLY_BLOCK;
+
+  const arma::uword start = (RC % nchunk) * APPLY_BLOCK;
+  len = std::min(APPLY_BLOCK, inner - start);
+  return outer_base(st, RC / nchunk) + start * istride;
+}
+
+//******************************************************************************
+
+inline arma::uword run_count(const apply_strides& st) noexcept {
+  const arma::uword inner = st.nf > 0 ? st.fdim[st.nf - 1] : 1;
+  return (st.nbase / inner) * ((inner + APPLY_BLOCK - 1) / APPLY_BLOCK);
+}
+
+//******************************************************************************
+
+// x[shift + base + off[M]] <- sum_N A(M, N) x[shift + base + off[N]]
+// Complex 2 x 2 and 4 x 4 operators on contiguous runs go through the
+// vectorized kernels of apply_simd.hpp.
+template <typename T1, typename T2>
+inline void apply_tuple(T1* x, const apply_strides& st, arma::uword shift,
+                        const arma::Mat<T2>& A) {
+  const arma::uword DS = st.off.n_elem;
+  const arma::uword* off = st.off.memptr();
+  const arma::uword istride = st.nf > 0 ? st.fstride[st.nf - 1] : 0;
+  const arma::uword nrun = run_count(st);
+
+  const auto simd_run =
+    istride == 1 ? simd_run_kernel<T1>(DS) : simd_run_t<T1>(nullptr);
+
+  if (simd_run != nullptr) {
+    const auto& B = as_type<arma::Mat<T1> >::from(A);
+    const T1* b = B.memptr();
+
+#if (defined(QICLIB_USE_OPENMP) || defined(QICLIB_USE_OPENMP_APPLY)) &&        \
+  defined(_OPENMP)
+#pragma omp parallel for
+#endif
+    for (arma::uword RC = 0; RC < nrun; ++RC) {
+      arma::uword len;
+      T1* p = x + shift + run_base(st, RC, len);
+      simd_run(p, off, len, b);
+    }
+
+  } else if (DS == 2) {
+    const T2 a00 = A.at(0, 0), a01 = A.at(0, 1);
+    const T2 a10 = A.at(1, 0), a11 = A.at(1, 1);
+    const arma::uword o1 = off[1];
+
+#if (defined(QICLIB_USE_OPENMP) || defined(QICLIB_USE_OPENMP_APPLY)) &&        \
+  defined(_OPENMP)
+#pragma omp parallel for
+#endif
+    for (arma::uword RC = 0; RC < nrun; ++RC) {
+      arma::uword len;
+      T1* p = x + shift + run_base(st, RC, len);
+      for (arma::uword r = 0; r < len; ++r, p += istride) {
+        const T1 v0 = p[0];
+        const T1 v1 = p[o1];
+        p[0] = a00 * v0 + a01 * v1;
+        p[o1] = a10 * v0 + a11 * v1;
+      }
+    }
+
+  } else {
+
+#if (defined(QICLIB_USE_OPENMP) || defined(QICLIB_USE_OPENMP_APPLY)) &&        \
+  defined(_OPENMP)
+#pragma omp parallel
+#endif
+    {
+      arma::Col<T1> buf(DS);
+
+#if (defined(QICLIB_USE_OPENMP) || defined(QICLIB_USE_OPENMP_APPLY)) &&        \
+  defined(_OPENMP)
+#pragma omp for
+#endif
+      for (arma::uword RC = 0; RC < nrun; ++RC) {
+        arma::uword len;
+        T1* p = x + shift + run_base(st, RC, len);
+        for (arma::uword r = 0; r < len; ++r, p += istride) {
+          for (arma::uword N = 0; N < DS; ++N)
+            buf.at(N) = p[off[N]];
+
+          for (arma::uword M = 0; M < DS; ++M) {
+            T1 ret(0);
+            for (arma::uword N = 0; N < DS; ++N)
+              ret += A.at(M, N) * buf.at(N);
+            p[off[M]] = ret;
+          }
+        }
+      }
+    }
+  }
+}
+
+//******************************************************************************
+
+// x[shift + base + off[M]] <- a[M] x[shift + base + off[M]]
+template <typename T1, typename T2>
+inline void apply_diag_tuple(T1* x, const apply_strides& st, arma::uword shift,
+                             const T2* a) {
+  const arma::uword DS = st.off.n_elem;
+  const arma::uword* off = st.off.memptr();
+  const arma::uword istride = st.nf > 0 ? st.fstride[st.nf - 1] : 0;
+  const arma::uword nrun = run_count(st);
+
+#if (defined(QICLIB_USE_OPENMP) || defined(QICLIB_USE_OPENMP_APPLY)) &&        \
+  defined(_OPENMP)
+#pragma omp parallel for
+#endif
+  for (arma::uword RC = 0; RC < nrun; ++RC) {
+    arma::uword len;
+    T1* p = x + shift + run_base(st, RC, len);
+    for (arma::uword r = 0; r < len; ++r, p += istride) {
+      for (arma::uword M = 0; M < DS; ++M)
+        p[off[M]] *= a[M];
+    }
+  }
+}
+
+//******************************************************************************
+
+template <typename T1>
+inline bool is_diag_op(const arma::Mat<T1>& A) noexcept {
+  for (arma::uword j = 0; j < A.n_cols; ++j)
+    for (arma::uword i = 0; i < A.n_rows; ++i)
+      if (i != j && A.at(i, j) != static_cast<T1>(0))
+        return false;
+  return true;
+}
+
+//******************************************************************************
+
+template <typename T1>
+inline bool is_eye_op(const arma::Mat<T1>& A) noexcept {
+  for (arma::uword j = 0; j < A.n_cols; ++j)
+    for (arma::uword i = 0; i < A.n_rows; ++i)
+      if (A.at(i, j) != static_cast<T1>(i == j ? 1 : 0))
+        return false;
+  return true;
+}
+
+//******************************************************************************
+
+// Diagonal counterpart of apply_ctrl_kernel, with a holding the diagonal of
+// A. A density matrix is updated in a single pass, rho(I, J) *= f(I) f(J)^*,
+// with f the full diagonal of CU; columns with f(J) = 1 only touch the rows
+// with f(I) != 1.
+template <typename T1, typename T2>
+inline void apply_ctrl_diag_kernel(arma::Mat<T1>& rho, const arma::Col<T2>& a,
+                                   const arma::uvec& ctrl,
+                                   const arma::uvec& subsys,
+                                   const arma::uvec& dim) {
+  const bool checkV = (rho.n_cols != 1);
+  const arma::uword d = ctrl.n_elem > 0 ? dim.at(ctrl.at(0) - 1) : 1;
+
+  arma::Col<T1> f;
+  if (checkV) {
+    f.set_size(rho.n_rows);
+    f.fill(static_cast<T1>(1));
+  }
+  T1* x = checkV ? f.memptr() : rho.memptr();
+
+  const auto st = make_apply_strides(ctrl, subsys, dim);
+
+  if (ctrl.n_elem == 0) {
+    apply_diag_tuple(x, st, 0, a.memptr());
+  } else {
+    // p = 0 and any other identity power leave the slice untouched
+    arma::Col<T2> ap(a);
+    for (arma::uword p = 1; p < d; ++p) {
+      if (arma::any(ap != static_cast<T2>(1)))
+        apply_diag_tuple(x, st, p * st.ctrl_stride, ap.memptr());
+      for (arma::uword M = 0; M < a.n_elem; ++M)
+        ap.at(M) *= a.at(M);
+    }
+  }
+
+  if (!checkV)
+    return;
+
+  const arma::uword D = rho.n_rows;
+
+  arma::uvec act(D);
+  arma::uword nact(0);
+  for (arma::uword I = 0; I < D; ++I)
+    if (f.at(I) != static_cast<T1>(1))
+      act.at(nact++) = I;
+
+  if (nact == 0)
+    return;
+
+#if (defined(QICLIB_USE_OPENMP) || defined(QICLIB_USE_OPENMP_APPLY)) &&        \
+  defined(_OPENMP)
+#pragma omp parallel for
+#endif
+  for (arma::uword J = 0; J < D; ++J) {
+    T1* col = rho.colptr(J);
+    if (f.at(J) == static_cast<T1>(1)) {
+      for (arma::uword k = 0; k < nact; ++k)
+        col[act.at(k)] *= f.at(act.at(k));
+    } else {
+      const T1 c = conj2(f.at(J));
+      for (arma::uword I = 0; I < D; ++I)
+        col[I] *= f.at(I) * c;
+    }
+  }
+}
+
+//******************************************************************************
+
+// If A is a permutation matrix, returns true and sets perm with
+// A(perm[N], N) = 1
+template <typename T1>
+inline bool is_perm_op(const arma::Mat<T1>& A, arma::uvec& perm) {
+  const arma::uword DS = A.n_rows;
+  perm.set_size(DS);
+
+  arma::Col<arma::uword> hit(DS);
+  hit.fill(0);
+
+  for (arma::uword N = 0; N < DS; ++N) {
+    arma::uword count(0);
+    for (arma::uword M = 0; M < DS; ++M) {
+      if (A.at(M, N) == static_cast<T1>(0))
+        continue;
+      if (A.at(M, N) != static_cast<T1>(1) || ++count > 1 || hit.at(M)++ > 0)
+        return false;
+      perm.at(N) = M;
+    }
+    if (count == 0)
+      return false;
+  }
+  return true;
+}
+
+//******************************************************************************
+
+// Nontrivial cycles of a permutation, stored as tuple offsets. Cycle c is
+// cyc[cstart[c]], ..., cyc[cstart[c + 1] - 1], with the amplitude at each
+// member moving to the next one.
+struct perm_cycles {
+  arma::uvec cyc;
+  arma::uvec cstart;
+};
+
+//******************************************************************************
+
+inline perm_cycles make_perm_cycles(const arma::uvec& perm,
+                                    const arma::uvec& off) {
+  const arma::uword DS = perm.n_elem;
+  arma::Col<arma::uword> seen(DS);
+  seen.fill(0);
+
+  arma::uword ncyc(0), nmem(0);
+  for (arma::uword N = 0; N < DS; ++N) {
+    if (seen.at(N) || perm.at(N) == N)
+      continue;
+    ++ncyc;
+    for (arma::uword M = N; !seen.at(M); M = perm.at(M)) {
+      seen.at(M) = 1;
+      ++nmem;
+    }
+  }
+
+  perm_cycles pc;
+  pc.cyc.set_size(nmem);
+  pc.cstart.set_size(ncyc + 1);
+  seen.fill(0);
+
+  arma::uword c(0), k(0);
+  for (arma::uword N = 0; N < DS; ++N) {
+    if (seen.at(N) || perm.at(N) == N)
+      continue;
+    pc.cstart.at(c++) = k;
+    for (arma::uword M = N; !seen.at(M); M = perm.at(M)) {
+      seen.at(M) = 1;
+      pc.cyc.at(k++) = off.at(M);
+    }
+  }
+  pc.cstart.at(ncyc) = nmem;
+  return pc;
+}
+
+//******************************************************************************
+
+// x[shift + base + off[perm[M]]] <- x[shift + base + off[M]]
+template <typename T1>
+inline void apply_perm_tuple(T1* x, const apply_strides& st, arma::uword shift,
+                             const perm_cycles& pc) {
+  const arma::uword ncyc = pc.cstart.n_elem - 1;
+  if (ncyc == 0)
+    return;
+
+  const arma::uword* cyc = pc.cyc.memptr();
+  const arma::uword* cstart = pc.cstart.memptr();
+  const arma::uword istride = st.nf > 0 ? st.fstride[st.nf - 1] : 0;
+  const arma::uword nrun = run_count(st);
+
+#if (defined(QICLIB_USE_OPENMP) || defined(QICLIB_USE_OPENMP_APPLY)) &&        \
+  defined(_OPENMP)
+#pragma omp parallel for
+#endif
+  for (arma::uword RC = 0; RC < nrun; ++RC) {
+    arma::uword len;
+    T1* p = x + shift + run_base(st, RC, len);
+    for (arma::uword r = 0; r < len; ++r, p += istride) {
+      for (arma::uword c = 0; c < ncyc; ++c) {
+        const arma::uword first = cstart[c];
+        const arma::uword last = cstart[c + 1] - 1;
+        const T1 tmp = p[cyc[last]];
+        for (arma::uword k = last; k > first; --k)
+          p[cyc[k]] = p[cyc[k - 1]];
+        p[cyc[first]] = tmp;
+      }
+    }
+  }
+}
+
+//******************************************************************************
+
+// Permutation counterpart of apply_ctrl_kernel, with A(perm[N], N) = 1. A
+// permutation matrix is real, so the row pass of a density matrix moves
+// whole columns along the same cycles.
+template <typename T1>
+inline void apply_ctrl_perm_kernel(arma::Mat<T1>& rho, const arma::uvec& perm,
+                                   const arma::uvec& ctrl,
+                                   const arma::uvec& subsys,
+                                   const arma::uvec& dim) {
+  const bool checkV = (rho.n_cols != 1);
+  const arma::uword d = ctrl.n_elem > 0 ? dim.at(ctrl.at(0) - 1) : 1;
+  const arma::uword DS = perm.n_elem;
+
+  auto st = make_apply_strides(ctrl, subsys, dim);
+  if (checkV)
+    push_free_axis(st, rho.n_cols, rho.n_rows);
+
+  apply_strides st2;
+  if (checkV) {
+    st2 = make_apply_strides(ctrl, subsys, dim, rho.n_rows);
+    push_free_axis(st2, rho.n_rows, 1);
+  }
+
+  if (ctrl.n_elem == 0) {
+    apply_perm_tuple(rho.memptr(), st, 0, make_perm_cycles(perm, st.off));
+    if (checkV)
+      apply_perm_tuple(rho.memptr(), st2, 0, make_perm_cycles(perm, st2.off));
+    return;
+  }
+
+  // p = 0 is the identity, and identity powers have no cycles
+  arma::uvec pp(perm);
+  for (arma::uword p = 1; p < d; ++p) {
+    apply_perm_tuple(rho.memptr(), st, p * st.ctrl_stride,
+                     make_perm_cycles(pp, st.off));
+    if (checkV)
+      apply_perm_tuple(rho.memptr(), st2, p * st2.ctrl_stride,
+                       make_perm_cycles(pp, st2.off));
+
+    for (arma::uword M = 0; M < DS; ++M)
+      pp.at(M) = perm.at(pp.at(M));
+  }
+}
+
+//******************************************************************************
+
+// rho <- CU rho CU^dagger (or CU rho for a column vector), in place, where
+// CU applies A^p on subsys when all ctrl subsystems are in state p. Only
+// the slices where A^p is not the identity are visited, i.e. 1 / d^k of
+// the state for k controls of dimension d and a generic A.
+template <typename T1, typename T2>
+inline void apply_ctrl_kernel(arma::Mat<T1>& rho, const arma::Mat<T2>& A,
+                              const arma::uvec& ctrl, const arma::uvec& subsys,
+                              const arma::uvec& dim) {
+  arma::uvec perm;
+  if (is_perm_op(A, perm)) {
+    apply_ctrl_perm_kernel(rho, perm, ctrl, subsys, dim);
+    return;
+  }
+
+  if (is_diag_op(A)) {
+    apply_ctrl_diag_kernel(rho, arma::Col<T2>(A.diag()), ctrl, subsys, dim);
+    return;
+  }
+
+  const bool checkV = (rho.n_cols != 1);
+  const arma::uword d = ctrl.n_elem > 0 ? dim.at(ctrl.at(0) - 1) : 1;
+
+  auto st = make_apply_strides(ctrl, subsys, dim);
+  if (checkV)
+    push_free_axis(st, rho.n_cols, rho.n_rows);
+
+  if (ctrl.n_elem == 0) {
+    apply_tuple(rho.memptr(), st, 0, A);
+  } else {
+    arma::Mat<T2> Ap(A);
+    for (arma::uword p = 1; p < d; ++p) {
+      if (!is_eye_op(Ap))
+        apply_tuple(rho.memptr(), st, p * st.ctrl_stride, Ap);
+      if (p + 1 < d)
+        Ap = Ap * A;
+    }
+  }
+
+  if (!checkV)
+    return;
+
+  auto st2 = make_apply_strides(ctrl, subsys, dim, rho.n_rows);
+  push_free_axis(st2, rho.n_rows, 1);
+
+  if (ctrl.n_elem == 0) {
+    const arma::Mat<T2> Ac = arma::conj(A);
+    apply_tuple(rho.memptr(), st2, 0, Ac);
+  } else {
+    arma::Mat<T2> Ap(A);
+    for (arma::uword p = 1; p < d; ++p) {
+      if (!is_eye_op(Ap)) {
+        const arma::Mat<T2> Ac = arma::conj(Ap);
+        apply_tuple(rho.memptr(), st2, p * st2.ctrl_stride, Ac);
+      }
+      if (p + 1 < d)
+        Ap = Ap * A;
+    }
+  }
+}
+
+//******************************************************************************
+
+// x[base + off[M]] <- DS^(-1/2) sum_N w^(MN) x[base + off[N]], with
+// w = exp(2 pi i / DS), or w^* for the inverse transform. The tuples of a
+// run are gathered as the columns of a DS x len matrix and transformed
+// together by arma::ifft / arma::fft, in O(DS log DS) per tuple.
+template <typename T1>
+inline void apply_fft_tuple(T1* x, const apply_strides& st, bool inverse) {
+  using pT = trait::GPT<T1>;
+
+  const arma::uword DS = st.off.n_elem;
+  const arma::uword* off = st.off.memptr();
+  const arma::uword istride = st.nf > 0 ? st.fstride[st.nf - 1] : 0;
+  const arma::uword nrun = run_count(st);
+
+  const pT sqrtDS = std::sqrt(static_cast<pT>(DS));
+  const pT s = inverse ? static_cast<pT>(1) / sqrtDS : sqrtDS;
+
+#if (defined(QICLIB_USE_OPENMP) || defined(QICLIB_USE_OPENMP_APPLY)) &&        \
+  defined(_OPENMP)
+#pragma omp parallel
+#endif
+  {
+    arma::Mat<T1> buf;
+
+#if (defined(QICLIB_USE_OPENMP) || defined(QICLIB_USE_OPENMP_APPLY)) &&        \
+  defined(_OPENMP)
+#pragma omp for
+#endif
+    for (arma::uword RC = 0; RC < nrun; ++RC) {
+      arma::uword len;
+      T1* p = x + run_base(st, RC, len);
+
+      buf.set_size(DS, len);
+      for (arma::uword r = 0; r < len; ++r)
+        for (arma::uword N = 0; N < DS; ++N)
+          buf.at(N, r) = p[r * istride + off[N]];
+
+      if (inverse)
+        buf = arma::fft(buf);
+      else
+        buf = arma::ifft(buf);
+
+      for (arma::uword r = 0; r < len; ++r)
+        for (arma::uword M = 0; M < DS; ++M)
+          p[r * istride + off[M]] = s * buf.at(M, r);
+    }
+  }
+}
+
+//******************************************************************************
+
+// rho <- F rho F^dagger (or F rho for a column vector), in place, with F the
+// quantum Fourier transform (or its inverse) on the joint register of
+// subsys. F is symmetric, so rho F^dagger is the conjugate transform applied
+// along the column index.
+template <typename T1>
+inline void apply_qft_kernel(arma::Mat<T1>& rho, const arma::uvec& subsys,
+                             const arma::uvec& dim, bool inverse) {
+  const bool checkV = (rho.n_cols != 1);
+
+  auto st = make_apply_strides({}, subsys, dim);
+  if (checkV)
+    push_free_axis(st, rho.n_cols, rho.n_rows);
+  apply_fft_tuple(rho.memptr(), st, inverse);
+
+  if (!checkV)
+    return;
+
+  auto st2 = make_apply_strides({}, subsys, dim, rho.n_rows);
+  push_free_axis(st2, rho.n_rows, 1);
+  apply_fft_tuple(rho.memptr(), st2, !inverse);
+}
+
+//******************************************************************************
+
+// Each column of X is a state vector of the register dim. Read column by
+// column, X is a vector over the register (X.n_cols, dim), so every pass of
+// the kernels runs over the whole batch.
+template <typename T1, typename T2>
+inline void apply_ctrl_batch_kernel(arma::Mat<T1>& X, const arma::Mat<T2>& A,
+                                    const arma::uvec& ctrl,
+                                    const arma::uvec& subsys,
+                                    const arma::uvec& dim) {
+  arma::Mat<T1> x(X.memptr(), X.n_elem, 1, false, true);
+
+  arma::uvec dim2(dim.n_elem + 1);
+  dim2.at(0) = X.n_cols;
+  for (arma::uword i = 0; i < dim.n_elem; ++i)
+    dim2.at(i + 1) = dim.at(i);
+
+  apply_ctrl_kernel(x, A, (ctrl + 1).eval(), (subsys + 1).eval(), dim2);
+}
+
+//******************************************************************************
+
+// Each slice of rhos is a state vector (n_cols == 1) or a density matrix of
+// the register dim
+template <typename T1, typename T2>
+inline void apply_ctrl_cube_kernel(arma::Cube<T1>& rhos, const arma::Mat<T2>& A,
+                                   const arma::uvec& ctrl,
+                                   const arma::uvec& subsys,
+                                   const arma::uvec& dim) {
+  if (rhos.n_cols == 1) {
+    arma::Mat<T1> X(rhos.memptr(), rhos.n_rows, rhos.n_slices, false, true);
+    apply_ctrl_batch_kernel(X, A, ctrl, subsys, dim);
+    return;
+  }
+
+  for (arma::uword s = 0; s < rhos.n_slices; ++s) {
+    arma::Mat<T1> rho(rhos.slice_memptr(s), rhos.n_rows, rhos.n_cols, false,
+                      true);
+    apply_ctrl_kernel(rho, A, ctrl, subsys, dim);
+  }
+}
+
+//******************************************************************************
+
+// Read column by column, a density matrix of the register dim is a vector
+// over the register (dim, dim), with the first half indexing its columns.
+// Spectator subsystems are merged before doubling, so that the doubled
+// register stays short.
+inline void kraus_register(const arma::uvec& subsys, const arma::uvec& dim,
+                           arma::uvec& subsys2, arma::uvec& dim2) {
+  const arma::uword n = dim.n_elem;
+
+  bool busy[MAXQDIT] = {false};
+  for (arma::uword i = 0; i < subsys.n_elem; ++i)
+    busy[subsys.at(i) - 1] = true;
+
+  arma::uword dimc[MAXQDIT], pos[MAXQDIT];
+  arma::uword nc(0), run(1);
+  for (arma::uword i = 0; i < n; ++i) {
+    if (busy[i]) {
+      if (run > 1)
+        dimc[nc++] = run;
+      run = 1;
+      pos[i] = nc;
+      dimc[nc++] = dim.at(i);
+    } else {
+      run *= dim.at(i);
+    }
+  }
+  if (run > 1)
+    dimc[nc++] = run;
+
+  dim2.set_size(2 * nc);
+  for (arma::uword i = 0; i < nc; ++i) {
+    dim2.at(i) = dimc[i];
+    dim2.at(i + nc) = dimc[i];
+  }
+
+  const arma::uword ns = subsys.n_elem;
+  subsys2.set_size(2 * ns);
+  for (arma::uword i = 0; i < ns; ++i) {
+    subsys2.at(i) = pos[subsys.at(i) - 1] + 1;
+    subsys2.at(i + ns) = pos[subsys.at(i) - 1] + 1 + nc;
+  }
+}
+
+//******************************************************************************
+
+// Local superoperator sum_k conj(K_k) (x) K_k of a Kraus set, acting on
+// vec(rho) restricted to the target subsystems of columns and rows
+template <typename T2, typename TK>
+inline arma::Mat<T2> kraus_superop(const TK& Ks) {
+  const arma::uword DS = (*Ks.begin()).n_rows;
+  arma::Mat<T2> S(DS * DS, DS * DS, arma::fill::zeros);
+  for (const auto& K : Ks)
+    S += arma::kron(arma::conj(K), K);
+  return S;
+}
+
+//******************************************************************************
+
+// rho <- sum_k K_k rho K_k^dagger, in place, with S = kraus_superop(Ks) and
+// the K_k acting on subsys
+template <typename T1, typename T2>
+inline void apply_kraus_kernel(arma::Mat<T1>& rho, const arma::Mat<T2>& S,
+                               const arma::uvec& subsys,
+                               const arma::uvec& dim) {
+  arma::uvec subsys2, dim2;
+  kraus_register(subsys, dim, subsys2, dim2);
+
+  arma::Mat<T1> vrho(rho.memptr(), rho.n_elem, 1, false, true);
+  apply_ctrl_kernel(vrho, S, {}, subsys2, dim2);
+}
+
+//******************************************************************************
+
+}  // namespace _internal
+
+}  // namespace qic
+
+#endif
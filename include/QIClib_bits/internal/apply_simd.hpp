@@ -0,0 +1,250 @@
+/*
+ * QIClib (Quantum information and computation library)
+ *
+ * Copyright (c) 2015 - 2019  Titas Chanda (titas.chanda@gmail.com)
+ *
+ * This file is part of QIClib.
+ *
+ * QIClib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QIClib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QIClib.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _QICLIB_INTERNAL_APPLY_SIMD_HPP_
+#define _QICLIB_INTERNAL_APPLY_SIMD_HPP_
+
+#include "../basic/macro.hpp"
+#include <armadillo>
+#include <complex>
+
+#ifdef QICLIB_SIMD
+#include <immintrin.h>
+#endif
+
+namespace qic {
+
+//************************************************************************
+
+namespace _internal {
+
+//******************************************************************************
+
+// Vectorized kernels for one run of len consecutive tuples of a 2 x 2 or
+// 4 x 4 complex operator,
+//   p[off[M] + r] <- sum_N a[M + N DS] p[off[N] + r],  r = 0, ..., len - 1,
+// with a the column-major operator. Consecutive tuples are packed into
+// one register, so the run has to be contiguous (unit free stride).
+
+template <typename T1>
+using simd_run_t = void (*)(T1*, const arma::uword*, arma::uword, const T1*);
+
+//******************************************************************************
+
+template <arma::uword DS, typename T1>
+inline void scalar_run(T1* p, const arma::uword* off, arma::uword r,
+                       arma::uword len, const T1* a) noexcept {
+  for (; r < len; ++r) {
+    T1 v[DS];
+    for (arma::uword N = 0; N < DS; ++N)
+      v[N] = p[off[N] + r];
+    for (arma::uword M = 0; M < DS; ++M) {
+      T1 ret(0);
+      for (arma::uword N = 0; N < DS; ++N)
+        ret += a[M + N * DS] * v[N];
+      p[off[M] + r] = ret;
+    }
+  }
+}
+
+//******************************************************************************
+
+#ifdef QICLIB_SIMD
+
+// The complex products are split as
+//   a v = addsub(Re(a) v, Im(a) swap(v)),
+// with swap exchanging the real and imaginary parts of every element, so
+// that the sums over N are plain fused multiply-adds.
+
+template <arma::uword DS>
+__attribute__((target("avx2,fma"))) inline void
+avx2_run(std::complex<double>* p, const arma::uword* off, arma::uword len,
+         const std::complex<double>* a) noexcept {
+  double* q = reinterpret_cast<double*>(p);
+  arma::uword r(0);
+
+  for (; r + 2 <= len; r += 2) {
+    __m256d v[DS], vs[DS];
+    for (arma::uword N = 0; N < DS; ++N) {
+      v[N] = _mm256_loadu_pd(q + 2 * (off[N] + r));
+      vs[N] = _mm256_permute_pd(v[N], 0x5);
+    }
+    for (arma::uword M = 0; M < DS; ++M) {
+      __m256d re = _mm256_setzero_pd(), im = _mm256_setzero_pd();
+      for (arma::uword N = 0; N < DS; ++N) {
+        re = _mm256_fmadd_pd(_mm256_set1_pd(a[M + N * DS].real()), v[N], re);
+        im = _mm256_fmadd_pd(_mm256_set1_pd(a[M + N * DS].imag()), vs[N], im);
+      }
+      _mm256_storeu_pd(q + 2 * (off[M] + r), _mm256_addsub_pd(re, im));
+    }
+  }
+  scalar_run<DS>(p, off, r, len, a);
+}
+
+//******************************************************************************
+
+template <arma::uword DS>
+__attribute__((target("avx2,fma"))) inline void
+avx2_run(std::complex<float>* p, const arma::uword* off, arma::uword len,
+         const std::complex<float>* a) noexcept {
+  float* q = reinterpret_cast<float*>(p);
+  arma::uword r(0);
+
+  for (; r + 4 <= len; r += 4) {
+    __m256 v[DS], vs[DS];
+    for (arma::uword N = 0; N < DS; ++N) {
+      v[N] = _mm256_loadu_ps(q + 2 * (off[N] + r));
+      vs[N] = _mm256_permute_ps(v[N], 0xB1);
+    }
+    for (arma::uword M = 0; M < DS; ++M) {
+      __m256 re = _mm256_setzero_ps(), im = _mm256_setzero_ps();
+      for (arma::uword N = 0; N < DS; ++N) {
+        re = _mm256_fmadd_ps(_mm256_set1_ps(a[M + N * DS].real()), v[N], re);
+        im = _mm256_fmadd_ps(_mm256_set1_ps(a[M + N * DS].imag()), vs[N], im);
+      }
+      _mm256_storeu_ps(q + 2 * (off[M] + r), _mm256_addsub_ps(re, im));
+    }
+  }
+  scalar_run<DS>(p, off, r, len, a);
+}
+
+//******************************************************************************
+
+template <arma::uword DS>
+__attribute__((target("avx512f"))) inline void
+avx512_run(std::complex<double>* p, const arma::uword* off, arma::uword len,
+           const std::complex<double>* a) noexcept {
+  double* q = reinterpret_cast<double*>(p);
+  const __m512d one = _mm512_set1_pd(1.0);
+  arma::uword r(0);
+
+  for (; r + 4 <= len; r += 4) {
+    __m512d v[DS], vs[DS];
+    for (arma::uword N = 0; N < DS; ++N) {
+      v[N] = _mm512_loadu_pd(q + 2 * (off[N] + r));
+      vs[N] = _mm512_mask_permute_pd(v[N], 0xFF, v[N], 0x55);
+    }
+    for (arma::uword M = 0; M < DS; ++M) {
+      __m512d re = _mm512_setzero_pd(), im = _mm512_setzero_pd();
+      for (arma::uword N = 0; N < DS; ++N) {
+        re = _mm512_fmadd_pd(_mm512_set1_pd(a[M + N * DS].real()), v[N], re);
+        im = _mm512_fmadd_pd(_mm512_set1_pd(a[M + N * DS].imag()), vs[N], im);
+      }
+      _mm512_storeu_pd(q + 2 * (off[M] + r), _mm512_fmaddsub_pd(one, re, im));
+    }
+  }
+  scalar_run<DS>(p, off, r, len, a);
+}
+
+//******************************************************************************
+
+template <arma::uword DS>
+__attribute__((target("avx512f"))) inline void
+avx512_run(std::complex<float>* p, const arma::uword* off, arma::uword len,
+           const std::complex<float>* a) noexcept {
+  float* q = reinterpret_cast<float*>(p);
+  const __m512 one = _mm512_set1_ps(1.0f);
+  arma::uword r(0);
+
+  for (; r + 8 <= len; r += 8) {
+    __m512 v[DS], vs[DS];
+    for (arma::uword N = 0; N < DS; ++N) {
+      v[N] = _mm512_loadu_ps(q + 2 * (off[N] + r));
+      vs[N] = _mm512_mask_permute_ps(v[N], 0xFFFF, v[N], 0xB1);
+    }
+    for (arma::uword M = 0; M < DS; ++M) {
+      __m512 re = _mm512_setzero_ps(), im = _mm512_setzero_ps();
+      for (arma::uword N = 0; N < DS; ++N) {
+        re = _mm512_fmadd_ps(_mm512_set1_ps(a[M + N * DS].real()), v[N], re);
+        im = _mm512_fmadd_ps(_mm512_set1_ps(a[M + N * DS].imag()), vs[N], im);
+      }
+      _mm512_storeu_ps(q + 2 * (off[M] + r), _mm512_fmaddsub_ps(one, re, im));
+    }
+  }
+  scalar_run<DS>(p, off, r, len, a);
+}
+
+//******************************************************************************
+
+// 0 : scalar, 1 : AVX2 + FMA, 2 : AVX-512F
+inline int simd_level() noexcept {
+  static const int level =
+    __builtin_cpu_supports("avx512f")
+      ? 2
+      : (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) ? 1
+                                                                         : 0;
+  return level;
+}
+
+#endif
+
+//******************************************************************************
+
+// Vectorized run kernel for DS amplitudes of type T1, or nullptr when
+// there is none for this type, size, or CPU
+template <typename T1>
+inline simd_run_t<T1> simd_run_kernel(arma::uword) noexcept {
+  return nullptr;
+}
+
+//******************************************************************************
+
+#ifdef QICLIB_SIMD
+
+template <typename T1>
+inline simd_run_t<T1> simd_run_kernel_cx(arma::uword DS) noexcept {
+  simd_run_t<T1> run2(nullptr), run4(nullptr);
+  switch (simd_level()) {
+  case 2:
+    run2 = &avx512_run<2>;
+    run4 = &avx512_run<4>;
+    break;
+  case 1:
+    run2 = &avx2_run<2>;
+    run4 = &avx2_run<4>;
+    break;
+  default:
+    break;
+  }
+  return DS == 2 ? run2 : DS == 4 ? run4 : nullptr;
+}
+
+template <>
+inline simd_run_t<std::complex<double> >
+simd_run_kernel<std::complex<double> >(arma::uword DS) noexcept {
+  return simd_run_kernel_cx<std::complex<double> >(DS);
+}
+
+template <>
+inline simd_run_t<std::complex<float> >
+simd_run_kernel<std::complex<float> >(arma::uword DS) noexcept {
+  return simd_run_kernel_cx<std::complex<float> >(DS);
+}
+
+#endif
+
+//******************************************************************************
+
+}  // namespace _internal
+
+}  // namespace qic
+
+#endif
@@ -24,6 +24,7 @@
 
 #include "../basic/type_traits.hpp"
 #include <armadillo>
+#include <utility>
 
 namespace qic {
 
@@ -109,6 +110,9 @@ template <typename out_type> class as_type {
  public:
   static inline const out_type& from(const out_type& A) { return A; }
 
+  // a temporary (or moved) result of the right type is passed on, not copied
+  static inline out_type from(out_type&& A) { return std::move(A); }
+
   template <typename T1, typename = typename std::enable_if<
                            std::is_base_of<out_type, T1>::value>::type>
   static inline const out_type& from(const T1& A) {
@@ -0,0 +1,139 @@
+/*
+ * QIClib (Quantum information and computation library)
+ *
+ * Copyright (c) 2015 - 2019  Titas Chanda (titas.chanda@gmail.com)
+ *
+ * This file is part of QIClib.
+ *
+ * QIClib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QIClib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QIClib.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _QICLIB_INTERNAL_BITS_HPP_
+#define _QICLIB_INTERNAL_BITS_HPP_
+
+#include "../basic/macro.hpp"
+#include <armadillo>
+
+#ifdef QICLIB_BMI2
+#include <immintrin.h>
+#endif
+
+namespace qic {
+
+//************************************************************************
+
+namespace _internal {
+
+//******************************************************************************
+
+// Index arithmetic for registers whose dimensions are all powers of two.
+// There, subsystem i of dim occupies the bit field of width log2(dim[i])
+// right above the fields of the subsystems after it, so digits come out by
+// shifts and masks and joint indices of several subsystems by bit scatter
+// (pdep) and gather (pext), instead of integer division.
+
+inline bool is_pow2(arma::uword d) noexcept {
+  return d != 0 && (d & (d - 1)) == 0;
+}
+
+//******************************************************************************
+
+inline arma::uword log2_pow2(arma::uword d) noexcept {
+  arma::uword k(0);
+  while (d >>= 1)
+    ++k;
+  return k;
+}
+
+//******************************************************************************
+
+// true if all dimensions are powers of two; then shift[i] is the position of
+// the lowest bit of subsystem i + 1
+inline bool pow2_shifts(const arma::uvec& dim, arma::uword* shift) noexcept {
+  const arma::uword n = dim.n_elem;
+  arma::uword s(0);
+  for (arma::uword i = n; i-- > 0;) {
+    if (!is_pow2(dim.at(i)))
+      return false;
+    shift[i] = s;
+    s += log2_pow2(dim.at(i));
+  }
+  return true;
+}
+
+//******************************************************************************
+
+// Bits of the (1-based) subsystems S, for shift as set by pow2_shifts
+inline arma::uword subsys_mask(const arma::uvec& S, const arma::uvec& dim,
+                               const arma::uword* shift) noexcept {
+  arma::uword mask(0);
+  for (arma::uword i = 0; i < S.n_elem; ++i)
+    mask |= (dim.at(S.at(i) - 1) - 1) << shift[S.at(i) - 1];
+  return mask;
+}
+
+//******************************************************************************
+
+// Low bits of x deposited, in order, at the set bits of mask
+inline arma::uword pdep(arma::uword x, arma::uword mask) noexcept {
+#ifdef QICLIB_BMI2
+  return static_cast<arma::uword>(
+    _pdep_u64(static_cast<unsigned long long>(x),
+              static_cast<unsigned long long>(mask)));
+#else
+  arma::uword ret(0);
+  for (arma::uword b = 1; mask != 0; b <<= 1) {
+    const arma::uword low = mask & (~mask + 1);
+    if (x & b)
+      ret |= low;
+    mask ^= low;
+  }
+  return ret;
+#endif
+}
+
+//******************************************************************************
+
+// Bits of x at the set bits of mask, packed into the low bits
+inline arma::uword pext(arma::uword x, arma::uword mask) noexcept {
+#ifdef QICLIB_BMI2
+  return static_cast<arma::uword>(
+    _pext_u64(static_cast<unsigned long long>(x),
+              static_cast<unsigned long long>(mask)));
+#else
+  arma::uword ret(0);
+  for (arma::uword b = 1; mask != 0; b <<= 1) {
+    const arma::uword low = mask & (~mask + 1);
+    if (x & low)
+      ret |= b;
+    mask ^= low;
+  }
+  return ret;
+#endif
+}
+
+//******************************************************************************
+
+// The value after x among those with bits only in mask, wrapping to 0
+inline arma::uword next_in_mask(arma::uword x, arma::uword mask) noexcept {
+  return ((x | ~mask) + 1) & mask;
+}
+
+//******************************************************************************
+
+}  // namespace _internal
+
+}  // namespace qic
+
+#endif
@@ -50,6 +50,22 @@ constexpr arma::uword MAXQDIT = QICLIB_MAXQDIT_COUNT;
 
 //******************************************************************************
 
+constexpr arma::uword APPLY_BLOCK = QICLIB_APPLY_BLOCK;
+
+//******************************************************************************
+
+constexpr arma::uword REDUCE_BLOCKS = QICLIB_REDUCE_BLOCKS;
+
+//******************************************************************************
+
+constexpr arma::uword TRANSPOSE_BLOCK = QICLIB_TRANSPOSE_BLOCK;
+
+//******************************************************************************
+
+constexpr arma::uword MMAP_CHUNK_BYTES = QICLIB_MMAP_CHUNK_BYTES;
+
+//******************************************************************************
+
 }  // namespace _internal
 
 }  // namespace qic
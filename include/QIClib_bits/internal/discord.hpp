@@ -24,6 +24,7 @@
 
 #include "../basic/type_traits.hpp"
 #include "../class/constants.hpp"
+#include "../class/plan.hpp"
 #include <armadillo>
 
 namespace qic {
@@ -42,11 +43,19 @@ template <typename T1> struct TO_PASS {
   arma::uvec& dim;
   arma::uword nodal;
   arma::uword party_no;
+  const trx_plan* trx;  // trace over the nodal subsystem (discord only)
 
   TO_PASS(T1& a, arma::Mat<trait::pT<T1> >& c, arma::Mat<trait::pT<T1> >& d,
           arma::Mat<trait::pT<T1> >& e, arma::uvec& f, arma::uword g,
-          arma::uword h)
-      : rho(a), eye2(c), eye3(d), eye4(e), dim(f), nodal(g), party_no(h) {}
+          arma::uword h, const trx_plan* tr = nullptr)
+      : rho(a),
+        eye2(c),
+        eye3(d),
+        eye4(e),
+        dim(f),
+        nodal(g),
+        party_no(h),
+        trx(tr) {}
 
   ~TO_PASS() = default;
 
@@ -103,12 +112,12 @@ inline double disc_nlopt2(const std::vector<double>& x,
   trait::pT<T1> S_max = 0.0;
   if (p1 > _precision::eps<trait::pT<T1> >::value) {
     rho_1 /= p1;
-    S_max += p1 * entropy(TrX(rho_1, {pB->nodal}, pB->dim));
+    S_max += p1 * entropy((*pB->trx)(rho_1, true));
   }
 
   if (p2 > _precision::eps<trait::pT<T1> >::value) {
     rho_2 /= p2;
-    S_max += p2 * entropy(TrX(rho_2, {pB->nodal}, pB->dim));
+    S_max += p2 * entropy((*pB->trx)(rho_2, true));
   }
   return static_cast<double>(S_max);
 }
@@ -197,15 +206,15 @@ inline double disc_nlopt3(const std::vector<double>& x,
   trait::pT<T1> S_max = 0.0;
   if (p1 > _precision::eps<trait::pT<T1> >::value) {
     rho_1 /= p1;
-    S_max += p1 * entropy(TrX(rho_1, {pB->nodal}, pB->nodal));
+    S_max += p1 * entropy((*pB->trx)(rho_1, true));
   }
   if (p2 > _precision::eps<trait::pT<T1> >::value) {
     rho_2 /= p2;
-    S_max += p2 * entropy(TrX(rho_2, {pB->nodal}, pB->nodal));
+    S_max += p2 * entropy((*pB->trx)(rho_2, true));
   }
   if (p3 > _precision::eps<trait::pT<T1> >::value) {
     rho_3 /= p3;
-    S_max += p3 * entropy(TrX(rho_3, {pB->nodal}, pB->nodal));
+    S_max += p3 * entropy((*pB->trx)(rho_3, true));
   }
 
   return static_cast<double>(S_max);
@@ -56,6 +56,29 @@ inline arma::uword lexi_to_num(const arma::uword* index,
 
 //******************************************************************************
 
+// Offsets, in the register dim, of the values M = 0, ..., DS - 1 of the
+// joint register of the subsystems S, the first being the most significant
+inline arma::uvec lexi_offsets(const arma::uvec& S, const arma::uvec& dim) {
+  arma::uvec off(1);
+  off.at(0) = 0;
+
+  for (arma::uword j = 0; j < S.n_elem; ++j) {
+    const arma::uword d = dim.at(S.at(j) - 1);
+    arma::uword stride(1);
+    for (arma::uword i = S.at(j); i < dim.n_elem; ++i)
+      stride *= dim.at(i);
+
+    arma::uvec off2(off.n_elem * d);
+    for (arma::uword a = 0; a < off.n_elem; ++a)
+      for (arma::uword k = 0; k < d; ++k)
+        off2.at(a * d + k) = off.at(a) + k * stride;
+    off = std::move(off2);
+  }
+  return off;
+}
+
+//******************************************************************************
+
 }  // namespace _internal
 
 }  // namespace qic
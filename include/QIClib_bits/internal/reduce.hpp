@@ -0,0 +1,92 @@
+/*
+ * QIClib (Quantum information and computation library)
+ *
+ * Copyright (c) 2015 - 2019  Titas Chanda (titas.chanda@gmail.com)
+ *
+ * This file is part of QIClib.
+ *
+ * QIClib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QIClib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QIClib.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _QICLIB_INTERNAL_REDUCE_HPP_
+#define _QICLIB_INTERNAL_REDUCE_HPP_
+
+#include "../basic/macro.hpp"
+#include "constants.hpp"
+#include <armadillo>
+#include <vector>
+
+#if (defined(QICLIB_USE_OPENMP) || defined(QICLIB_USE_OPENMP_APPLY)) &&        \
+  defined(_OPENMP)
+#include <omp.h>
+#endif
+
+namespace qic {
+
+//************************************************************************
+
+namespace _internal {
+
+//******************************************************************************
+
+// sum_{i < n} term(i) as an n_rows x n_cols matrix, with add(acc, i) adding
+// term(i) to acc. The terms are split into contiguous blocks, each summed
+// in order into its own accumulator, and the partial sums are combined
+// pairwise in a fixed tree, so no locking is needed. By default there is
+// one block per thread; with QICLIB_DETERMINISTIC_REDUCE the block count
+// is REDUCE_BLOCKS, making the result independent of the thread count.
+template <typename TM, typename F>
+inline TM reduce_sum(arma::uword n, arma::uword n_rows, arma::uword n_cols,
+                     F&& add) {
+#if defined(QICLIB_DETERMINISTIC_REDUCE)
+  arma::uword nb = REDUCE_BLOCKS;
+#elif (defined(QICLIB_USE_OPENMP) || defined(QICLIB_USE_OPENMP_APPLY)) &&      \
+  defined(_OPENMP)
+  arma::uword nb = static_cast<arma::uword>(omp_get_max_threads());
+#else
+  arma::uword nb = 1;
+#endif
+  nb = std::max(static_cast<arma::uword>(1), std::min(nb, n));
+
+  std::vector<TM> part(nb);
+
+#if (defined(QICLIB_USE_OPENMP) || defined(QICLIB_USE_OPENMP_APPLY)) &&        \
+  defined(_OPENMP)
+#pragma omp parallel for schedule(static)
+#endif
+  for (arma::uword b = 0; b < nb; ++b) {
+    part[b].zeros(n_rows, n_cols);
+    for (arma::uword i = b * n / nb; i < (b + 1) * n / nb; ++i)
+      add(part[b], i);
+  }
+
+  for (arma::uword step = 1; step < nb; step *= 2) {
+#if (defined(QICLIB_USE_OPENMP) || defined(QICLIB_USE_OPENMP_APPLY)) &&        \
+  defined(_OPENMP)
+#pragma omp parallel for
+#endif
+    for (arma::uword b = 0; b < nb - step; b += 2 * step)
+      part[b] += part[b + step];
+  }
+
+  return std::move(part[0]);
+}
+
+//******************************************************************************
+
+}  // namespace _internal
+
+}  // namespace qic
+
+#endif
@@ -0,0 +1,350 @@
+/*
+ * QIClib (Quantum information and computation library)
+ *
+ * Copyright (c) 2015 - 2019  Titas Chanda (titas.chanda@gmail.com)
+ *
+ * This file is part of QIClib.
+ *
+ * QIClib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QIClib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QIClib.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _QICLIB_INTERNAL_SAMPLING_HPP_
+#define _QICLIB_INTERNAL_SAMPLING_HPP_
+
+#include "../basic/macro.hpp"
+#include "../basic/type_traits.hpp"
+#include "../class/random_devices.hpp"
+#include "apply_kernel.hpp"
+#include "as_arma.hpp"
+#include "conj2.hpp"
+#include "reduce.hpp"
+#include <armadillo>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace qic {
+
+//************************************************************************
+
+namespace _internal {
+
+//******************************************************************************
+
+// Walker's alias table (Vose's construction) for O(1) sampling from a
+// fixed discrete distribution. prob need not be normalized.
+template <typename T1> class alias_table {
+ public:
+  explicit alias_table(const arma::Col<T1>& prob)
+      : n(prob.n_elem), q(prob.n_elem), alias(prob.n_elem) {
+    using aT = typename acc_type<T1>::type;
+
+    aT total(0);
+    for (arma::uword i = 0; i < n; ++i)
+      total += prob.at(i);
+
+    arma::Col<aT> p(n);
+    arma::uvec small(n), large(n);
+    arma::uword ns(0), nl(0);
+    for (arma::uword i = 0; i < n; ++i) {
+      p.at(i) = static_cast<aT>(prob.at(i)) * static_cast<aT>(n) / total;
+      if (p.at(i) < 1)
+        small.at(ns++) = i;
+      else
+        large.at(nl++) = i;
+    }
+
+    while (ns > 0 && nl > 0) {
+      const arma::uword s = small.at(--ns);
+      const arma::uword l = large.at(--nl);
+      q.at(s) = static_cast<T1>(p.at(s));
+      alias.at(s) = l;
+      p.at(l) = (p.at(l) + p.at(s)) - 1;
+      if (p.at(l) < 1)
+        small.at(ns++) = l;
+      else
+        large.at(nl++) = l;
+    }
+
+    // leftovers are 1 up to rounding
+    while (nl > 0) {
+      const arma::uword l = large.at(--nl);
+      q.at(l) = 1;
+      alias.at(l) = l;
+    }
+    while (ns > 0) {
+      const arma::uword s = small.at(--ns);
+      q.at(s) = 1;
+      alias.at(s) = s;
+    }
+  }
+
+  template <typename RNG> inline arma::uword operator()(RNG& rng) const {
+    const double u =
+      std::generate_canonical<double, std::numeric_limits<double>::digits>(
+        rng) *
+      static_cast<double>(n);
+    const arma::uword i = std::min(static_cast<arma::uword>(u), n - 1);
+    return (u - static_cast<double>(i)) < static_cast<double>(q.at(i))
+             ? i
+             : alias.at(i);
+  }
+
+  inline arma::uword size() const noexcept { return n; }
+
+ private:
+  arma::uword n;
+  arma::Col<T1> q;
+  arma::uvec alias;
+};
+
+//******************************************************************************
+
+// Probabilities of the computational-basis outcomes of subsys (lexi order
+// over subsys as given), summed over all other indices in one pass over a
+// state vector or the diagonal of a density matrix
+template <typename T1>
+inline arma::Col<trait::GPT<T1> > marginal_prob(const arma::Mat<T1>& rho,
+                                               const arma::uvec& subsys,
+                                               const arma::uvec& dim) {
+  using pT = trait::GPT<T1>;
+  using aT = typename acc_type<pT>::type;
+
+  const bool checkV = (rho.n_cols != 1);
+  const T1* x = rho.memptr();
+  const arma::uword step = checkV ? rho.n_rows + 1 : 1;
+
+  const auto st = make_apply_strides({}, subsys, dim);
+  const arma::uword DS = st.off.n_elem;
+  const arma::uword* off = st.off.memptr();
+  const arma::uword istride = st.nf > 0 ? st.fstride[st.nf - 1] : 0;
+
+  auto prob = reduce_sum<arma::Col<aT> >(
+    run_count(st), DS, 1, [&](arma::Col<aT>& acc, arma::uword RC) {
+      arma::uword len;
+      const arma::uword base = run_base(st, RC, len);
+      for (arma::uword r = 0; r < len; ++r) {
+        const arma::uword I = base + r * istride;
+        for (arma::uword M = 0; M < DS; ++M)
+          acc.at(M) += checkV ? std::abs(x[(I + off[M]) * step])
+                              : std::norm(x[I + off[M]]);
+      }
+    });
+
+  return as_type<arma::Col<pT> >::from(std::move(prob));
+}
+
+//******************************************************************************
+
+// Probabilities of measuring subsys in the basis formed by the columns of U,
+// in one streaming pass: |<u_k|x>|^2 summed over the spectator indices of a
+// state vector, or <u_k|rho|u_k> over the diagonal blocks of a density
+// matrix
+template <typename T1, typename T2>
+inline arma::Col<trait::GPT<T1> > marginal_prob(const arma::Mat<T1>& rho,
+                                                const arma::Mat<T2>& U,
+                                                const arma::uvec& subsys,
+                                                const arma::uvec& dim) {
+  using pT = trait::GPT<T1>;
+  using aT = typename acc_type<typename promote_var<T1, T2>::type>::type;
+
+  const bool checkV = (rho.n_cols != 1);
+  const T1* x = rho.memptr();
+  const arma::uword D = rho.n_rows;
+
+  const auto st = make_apply_strides({}, subsys, dim);
+  const arma::uword DS = st.off.n_elem;
+  const arma::uword* off = st.off.memptr();
+  const arma::uword istride = st.nf > 0 ? st.fstride[st.nf - 1] : 0;
+
+  auto prob = reduce_sum<arma::Col<trait::GPT<aT> > >(
+    run_count(st), DS, 1, [&](arma::Col<trait::GPT<aT> >& acc, arma::uword RC) {
+      arma::uword len;
+      const arma::uword base = run_base(st, RC, len);
+      for (arma::uword r = 0; r < len; ++r) {
+        const arma::uword I = base + r * istride;
+        for (arma::uword k = 0; k < DS; ++k) {
+          if (!checkV) {
+            aT s(0);
+            for (arma::uword N = 0; N < DS; ++N)
+              s += conj2(U.at(N, k)) * x[I + off[N]];
+            acc.at(k) += std::norm(s);
+          } else {
+            aT s(0);
+            for (arma::uword N = 0; N < DS; ++N) {
+              aT t(0);
+              for (arma::uword M = 0; M < DS; ++M)
+                t += conj2(U.at(M, k)) * x[I + off[M] + (I + off[N]) * D];
+              s += t * static_cast<aT>(U.at(N, k));
+            }
+            acc.at(k) += std::real(s);
+          }
+        }
+      }
+    });
+
+  for (auto& p : prob)
+    p = std::max(p, static_cast<trait::GPT<aT> >(0));
+  return as_type<arma::Col<pT> >::from(std::move(prob));
+}
+
+//******************************************************************************
+
+// Block of rho on subsys (lexi order over subsys as given) summed over the
+// spectator indices, i.e. the reduced state on subsys, in one pass over a
+// state vector or a density matrix
+template <typename T1>
+inline arma::Mat<T1> reduced_block(const arma::Mat<T1>& rho,
+                                   const arma::uvec& subsys,
+                                   const arma::uvec& dim) {
+  using aT = typename acc_type<T1>::type;
+
+  const bool checkV = (rho.n_cols != 1);
+  const T1* x = rho.memptr();
+  const arma::uword D = rho.n_rows;
+
+  const auto st = make_apply_strides({}, subsys, dim);
+  const arma::uword DS = st.off.n_elem;
+  const arma::uword* off = st.off.memptr();
+  const arma::uword istride = st.nf > 0 ? st.fstride[st.nf - 1] : 0;
+
+  auto R = reduce_sum<arma::Mat<aT> >(
+    run_count(st), DS, DS, [&](arma::Mat<aT>& acc, arma::uword RC) {
+      arma::uword len;
+      const arma::uword base = run_base(st, RC, len);
+      for (arma::uword r = 0; r < len; ++r) {
+        const arma::uword I = base + r * istride;
+        for (arma::uword N = 0; N < DS; ++N)
+          for (arma::uword M = 0; M < DS; ++M)
+            acc.at(M, N) += checkV ? x[I + off[M] + (I + off[N]) * D]
+                                   : x[I + off[M]] * conj2(x[I + off[N]]);
+      }
+    });
+
+  return as_type<arma::Mat<T1> >::from(std::move(R));
+}
+
+//******************************************************************************
+
+// Probability tr(P rho P^dag) of the outcome with measurement operator
+// P = K, or P = k k^dag when K is a column k, without forming P rho P^dag
+template <typename T1, typename T2>
+inline trait::GPT<T1> outcome_prob(const arma::Mat<T1>& rho,
+                                   const arma::Mat<T2>& K) {
+  const bool checkV = (rho.n_cols != 1);
+
+  if (K.n_cols != 1)
+    return checkV ? std::abs(arma::trace(K * rho * K.t()))
+                  : std::pow(arma::norm(as_Col((K * rho).eval())), 2);
+
+  const trait::GPT<T1> kk = std::pow(arma::norm(as_Col(K)), 2);
+  return checkV ? std::abs(arma::as_scalar(K.t() * rho * K)) * kk
+                : std::norm(arma::as_scalar(K.t() * rho)) * kk;
+}
+
+//******************************************************************************
+
+// Probabilities of the n outcomes with measurement operators op(i)
+template <typename T1, typename F>
+inline arma::Col<trait::GPT<T1> > outcome_probs(const arma::Mat<T1>& rho,
+                                               arma::uword n, F&& op) {
+  arma::Col<trait::GPT<T1> > prob(n);
+
+#if (defined(QICLIB_USE_OPENMP) || defined(QICLIB_USE_OPENMP_MEASURE)) &&      \
+  defined(_OPENMP)
+#pragma omp parallel for
+#endif
+  for (arma::uword i = 0; i < n; ++i)
+    prob.at(i) = outcome_prob(rho, op(i));
+
+  return prob;
+}
+
+//******************************************************************************
+
+// The outcome probabilities of operators acting on subsys only depend on
+// the reduced block, so rho is read once whatever the number of outcomes
+template <typename T1, typename F>
+inline arma::Col<trait::GPT<T1> >
+outcome_probs(const arma::Mat<T1>& rho, arma::uword n, F&& op,
+              const arma::uvec& subsys, const arma::uvec& dim) {
+  return outcome_probs(reduced_block(rho, subsys, dim), n,
+                       std::forward<F>(op));
+}
+
+//******************************************************************************
+
+// Normalized post-measurement state P rho P^dag / p (P psi / sqrt(p) for a
+// state vector), with P as in outcome_prob
+template <typename T1, typename T2>
+inline arma::Mat<typename promote_var<T1, T2>::type>
+outcome_state(const arma::Mat<T1>& rho, const arma::Mat<T2>& K,
+              trait::GPT<T1> p) {
+  const bool checkV = (rho.n_cols != 1);
+
+  if (K.n_cols != 1)
+    return checkV ? (K * rho * K.t() / p).eval()
+                  : (K * rho / std::sqrt(p)).eval();
+
+  return checkV ? (K * (K.t() * rho * K) * K.t() / p).eval()
+                : (K * (K.t() * rho) / std::sqrt(p)).eval();
+}
+
+//******************************************************************************
+
+// Shots are drawn in blocks of SHOT_BLOCK, each from its own generator
+// seeded by the calling thread's rdevs.rng, so that the outcomes follow
+// rdevs.set_seed whatever the thread count
+constexpr arma::uword SHOT_BLOCK = 16384;
+
+template <typename T1>
+inline void sample_shots(const arma::Col<T1>& prob, arma::uword nshots,
+                         arma::uvec& outcomes, arma::uvec& counts) {
+  using rng_type = decltype(rdevs.rng);
+
+  const alias_table<T1> table(prob);
+  const arma::uword nblock = (nshots + SHOT_BLOCK - 1) / SHOT_BLOCK;
+
+  std::vector<RandomDevices::seed_type> seeds(nblock);
+  for (auto& seed : seeds)
+    seed = rdevs.rng();
+
+  outcomes.set_size(nshots);
+
+#if (defined(QICLIB_USE_OPENMP) || defined(QICLIB_USE_OPENMP_MEASURE)) &&      \
+  defined(_OPENMP)
+#pragma omp parallel for
+#endif
+  for (arma::uword b = 0; b < nblock; ++b) {
+    rng_type rng(seeds[b]);
+    const arma::uword end = std::min(nshots, (b + 1) * SHOT_BLOCK);
+    for (arma::uword i = b * SHOT_BLOCK; i < end; ++i)
+      outcomes.at(i) = table(rng);
+  }
+
+  counts = reduce_sum<arma::uvec>(
+    nblock, prob.n_elem, 1, [&](arma::uvec& acc, arma::uword b) {
+      const arma::uword end = std::min(nshots, (b + 1) * SHOT_BLOCK);
+      for (arma::uword i = b * SHOT_BLOCK; i < end; ++i)
+        ++acc.at(outcomes.at(i));
+    });
+}
+
+//******************************************************************************
+
+}  // namespace _internal
+
+}  // namespace qic
+
+#endif
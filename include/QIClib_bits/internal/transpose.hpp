@@ -0,0 +1,243 @@
+/*
+ * QIClib (Quantum information and computation library)
+ *
+ * Copyright (c) 2015 - 2019  Titas Chanda (titas.chanda@gmail.com)
+ *
+ * This file is part of QIClib.
+ *
+ * QIClib is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * QIClib is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QIClib.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _QICLIB_INTERNAL_TRANSPOSE_HPP_
+#define _QICLIB_INTERNAL_TRANSPOSE_HPP_
+
+#include "../basic/macro.hpp"
+#include "constants.hpp"
+#include <algorithm>
+#include <armadillo>
+
+namespace qic {
+
+//************************************************************************
+
+namespace _internal {
+
+//******************************************************************************
+
+// Axis permutation of a tensor with axes of dimensions dim[0], ...,
+// dim[n - 1], n > 0 (the last one contiguous), where axis a of the output
+// is axis axes[a] of the input. Output axes that are also adjacent in the
+// input are merged and size-1 axes dropped, leaving m axes of dimensions
+// md, input strides ms and output strides os. If the innermost output axis
+// A is the innermost input axis, whole runs are copied; otherwise A and the
+// input's unit-stride axis B are moved in TRANSPOSE_BLOCK x TRANSPOSE_BLOCK
+// tiles, so that both the reads and the writes of a tile stay in cache.
+
+struct permute_axes_desc {
+  arma::uword md[2 * MAXQDIT];
+  arma::uword ms[2 * MAXQDIT];
+  arma::uword os[2 * MAXQDIT];
+  arma::uword m;
+  arma::uword A;
+  arma::uword B;
+  arma::uword nA;     // tiles along A
+  arma::uword nB;     // tiles along B
+  arma::uword ntask;  // runs (B == A) or tiles
+};
+
+//******************************************************************************
+
+inline permute_axes_desc make_permute_axes(const arma::uword* dim,
+                                           const arma::uword* axes,
+                                           arma::uword n) noexcept {
+  permute_axes_desc pd;
+
+  arma::uword istride[2 * MAXQDIT];
+  istride[n - 1] = 1;
+  for (arma::uword i = n - 1; i-- > 0;)
+    istride[i] = istride[i + 1] * dim[i + 1];
+
+  arma::uword m(0);
+  for (arma::uword a = 0; a < n; ++a) {
+    const arma::uword d = dim[axes[a]];
+    const arma::uword s = istride[axes[a]];
+    if (d == 1)
+      continue;
+    if (m > 0 && pd.ms[m - 1] == s * d) {
+      pd.md[m - 1] *= d;
+      pd.ms[m - 1] = s;
+    } else {
+      pd.md[m] = d;
+      pd.ms[m] = s;
+      ++m;
+    }
+  }
+  pd.m = m;
+
+  if (m == 0) {
+    pd.A = pd.B = 0;
+    pd.nA = pd.nB = pd.ntask = 1;
+    return pd;
+  }
+
+  pd.os[m - 1] = 1;
+  for (arma::uword k = m - 1; k-- > 0;)
+    pd.os[k] = pd.os[k + 1] * pd.md[k + 1];
+  const arma::uword total = pd.os[0] * pd.md[0];
+
+  pd.A = m - 1;
+  pd.B = pd.A;
+  for (arma::uword k = 0; k < m; ++k)
+    if (pd.ms[k] < pd.ms[pd.B])
+      pd.B = k;
+
+  const arma::uword TB = TRANSPOSE_BLOCK;
+  if (pd.B == pd.A) {
+    pd.nA = pd.nB = 1;
+    pd.ntask = total / pd.md[pd.A];
+  } else {
+    pd.nA = (pd.md[pd.A] + TB - 1) / TB;
+    pd.nB = (pd.md[pd.B] + TB - 1) / TB;
+    pd.ntask = (total / (pd.md[pd.A] * pd.md[pd.B])) * pd.nB * pd.nA;
+  }
+  return pd;
+}
+
+//******************************************************************************
+
+// out <- in with the axes permuted as described by pd
+template <typename T1>
+inline void permute_axes(const T1* in, T1* out,
+                         const permute_axes_desc& pd) noexcept {
+  const arma::uword m = pd.m;
+  const arma::uword* md = pd.md;
+  const arma::uword* ms = pd.ms;
+  const arma::uword* os = pd.os;
+  const arma::uword A = pd.A;
+  const arma::uword B = pd.B;
+
+  if (m == 0) {
+    out[0] = in[0];
+    return;
+  }
+
+  if (B == A) {
+    const arma::uword len = md[A];
+    const arma::uword sA = ms[A];
+
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+    for (arma::uword R = 0; R < pd.ntask; ++R) {
+      arma::uword r(R), ibase(0);
+      for (arma::uword k = A; k-- > 0;) {
+        ibase += (r % md[k]) * ms[k];
+        r /= md[k];
+      }
+
+      const T1* pi = in + ibase;
+      T1* po = out + R * len;
+      if (sA == 1)
+        std::copy(pi, pi + len, po);
+      else
+        for (arma::uword a = 0; a < len; ++a)
+          po[a] = pi[a * sA];
+    }
+    return;
+  }
+
+  const arma::uword TB = TRANSPOSE_BLOCK;
+  const arma::uword nA = pd.nA;
+  const arma::uword nB = pd.nB;
+
+#if defined(_OPENMP)
+#pragma omp parallel for
+#endif
+  for (arma::uword task = 0; task < pd.ntask; ++task) {
+    const arma::uword tA = task % nA;
+    const arma::uword tB = (task / nA) % nB;
+    arma::uword r = task / (nA * nB);
+
+    arma::uword ibase(0), obase(0);
+    for (arma::uword k = m; k-- > 0;) {
+      if (k == A || k == B)
+        continue;
+      const arma::uword dk = r % md[k];
+      r /= md[k];
+      ibase += dk * ms[k];
+      obase += dk * os[k];
+    }
+
+    const arma::uword a0 = tA * TB;
+    const arma::uword a1 = std::min(a0 + TB, md[A]);
+    const arma::uword b0 = tB * TB;
+    const arma::uword b1 = std::min(b0 + TB, md[B]);
+
+    const T1* pi = in + ibase;
+    T1* po = out + obase;
+    for (arma::uword b = b0; b < b1; ++b)
+      for (arma::uword a = a0; a < a1; ++a)
+        po[a + b * os[B]] = pi[a * ms[A] + b * ms[B]];
+  }
+}
+
+//******************************************************************************
+
+template <typename T1>
+inline void permute_axes(const T1* in, T1* out, const arma::uword* dim,
+                         const arma::uword* axes, arma::uword n) noexcept {
+  permute_axes(in, out, make_permute_axes(dim, axes, n));
+}
+
+//******************************************************************************
+
+// Axes of sysperm: the n subsystems of a state vector (matrix = false), or
+// the 2n row and column subsystems of a density matrix (column-major, so the
+// column digits are the outer axes). Output subsystem i is input subsystem
+// perm[i].
+inline permute_axes_desc make_sysperm_axes(const arma::uvec& perm,
+                                           const arma::uvec& dim,
+                                           bool matrix) noexcept {
+  const arma::uword n = dim.n_elem;
+
+  arma::uword dim2[2 * MAXQDIT] = {0}, axes[2 * MAXQDIT] = {0};
+  for (arma::uword i = 0; i < n; ++i) {
+    dim2[i] = dim2[i + n] = dim.at(i);
+    axes[i] = perm.at(i) - 1;
+    axes[i + n] = n + perm.at(i) - 1;
+  }
+
+  return matrix ? make_permute_axes(dim2, axes, 2 * n)
+                : make_permute_axes(dim2, axes, n);
+}
+
+//******************************************************************************
+
+template <typename T1>
+inline void sysperm_kernel(const arma::Mat<T1>& rho, arma::Mat<T1>& ret,
+                           const arma::uvec& perm, const arma::uvec& dim) {
+  const bool checkV = (rho.n_cols != 1);
+
+  ret.set_size(rho.n_rows, rho.n_cols);
+  permute_axes(rho.memptr(), ret.memptr(),
+               make_sysperm_axes(perm, dim, checkV));
+}
+
+//******************************************************************************
+
+}  // namespace _internal
+
+}  // namespace qic
+
+#endif